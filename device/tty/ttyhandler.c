@@ -1,6 +1,7 @@
 /* ttyhandler.c - ttyhandler */
 
 #include <xinu.h>
+#include <usb_cdc_conf.h>
 
 /*------------------------------------------------------------------------
  *  ttyhandler  -  Handle an interrupt for a tty (serial) device
@@ -28,5 +29,28 @@ void ttyhandler(uint32 xnum, char c, int flag) {
 	}else{		/* RX */
 		ttyhandle_in(typtr, c);
  	}
- 	yield();
+}
+
+/*------------------------------------------------------------------------
+ *  ttyrxwork  -  Deferred work posted by the USB CDC receive interrupt:
+ *		    move every byte waiting in the CDC ring to the tty
+ *------------------------------------------------------------------------
+ */
+void	ttyrxwork(
+	  int32		arg		/* Unused			*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	ttycblk	*typtr;		/* Pointer to ttytab entry	*/
+
+	typtr = &ttytab[devtab[CONSOLE].dvminor];
+
+	/* Interrupts are off for one char at a time so the USB	*/
+	/*   interrupt can keep filling the ring during a batch	*/
+
+	while (usb_available()) {
+		mask = disable();
+		ttyhandle_in(typtr, usb_getc());
+		restore(mask);
+	}
 }
@@ -11,11 +11,13 @@
 void	ttykickout(
 	)
 {
+	intmask	mask;			/* Saved interrupt mask		*/
+
 	/* Force the UART hardware generate an output interrupt */
 
-	disable();
+	mask = disable();
 	ttyhandler(1, 'X', 1);		/* 1, 'X' arguments useless  */
-	enable();
+	restore(mask);
 
 	return;
 }
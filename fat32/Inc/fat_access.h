@@ -50,6 +50,53 @@ struct fat_buffer
     struct fat_buffer       *next;
 };
 
+// FAT sector cache entry, holding FAT_BUFFER_SECTORS sectors in a slot
+// of fatfs.fat_data (flushes may move an entry to another slot)
+struct fat_cache_buf
+{
+    uint8 *                 sector;
+    uint32                  address;
+    int                     dirty;
+    uint8 *                 ptr;
+
+    // LRU list, most recently used first
+    struct fat_cache_buf    *prev;
+    struct fat_cache_buf    *next;
+
+    // Next in the hash chain for this address
+    struct fat_cache_buf    *hnext;
+};
+
+// FAT sector cache counters
+struct fat_stats
+{
+    uint32                  hits;       // Lookups found in the cache
+    uint32                  misses;     // Lookups read from the media
+    uint32                  writes;     // write_media calls made to flush
+    uint32                  sectors;    // Sectors those calls wrote
+    uint32                  dentry_hits;    // Names found in the directory entry cache
+    uint32                  dentry_misses;  // Names searched for in the directory
+};
+
+// Directory entry cache entry: a name found in a directory, with a copy
+// of its SFN entry and where that entry is on disk
+struct fat_dentry
+{
+    uint32                  parent;     // Start cluster of the directory
+    uint32                  hash;       // Hash of the name
+    uint32                  lba;        // Sector holding the SFN entry
+    uint16                  offset;     // Offset of the SFN entry in it
+    char                    name[FAT_DENTRY_NAME_LENGTH];   // Lower case, "" if unused
+    struct fat_dir_entry    entry;
+
+    // LRU list, most recently used first
+    struct fat_dentry       *prev;
+    struct fat_dentry       *next;
+
+    // Next in the hash chain for this name
+    struct fat_dentry       *hnext;
+};
+
 typedef enum eFatType
 {
     FAT_TYPE_16,
@@ -69,6 +116,7 @@ struct fatfs
     uint32                  lba_begin;
     uint32                  fat_sectors;
     uint32                  next_free_cluster;
+    uint32                  cluster_limit;      // Last data cluster + 1
     uint16                  root_entry_count;
     uint16                  reserved_sectors;
     uint8                   num_of_fats;
@@ -85,8 +133,29 @@ struct fatfs
     struct fat_buffer        currentsector;
 
     // FAT Buffer
-    struct fat_buffer        *fat_buffer_head;
-    struct fat_buffer        fat_buffers[FAT_BUFFERS];
+    struct fat_cache_buf     *fat_buffer_head;
+    struct fat_cache_buf     *fat_buffer_tail;
+    struct fat_cache_buf     *fat_hash[FAT_BUFFER_HASH];
+    struct fat_cache_buf     fat_buffers[FAT_BUFFERS];
+    uint8                    fat_data[FAT_BUFFERS][FAT_SECTOR_SIZE * FAT_BUFFER_SECTORS];
+    struct fat_stats         fat_stats;
+
+#if FAT_DENTRY_ENTRIES
+    // Directory entry cache
+    struct fat_dentry        *dentry_head;
+    struct fat_dentry        *dentry_tail;
+    struct fat_dentry        *dentry_hash[FAT_DENTRY_HASH];
+    struct fat_dentry        dentries[FAT_DENTRY_ENTRIES];
+#endif
+
+#if FAT_FREE_MAP_CLUSTERS
+    // Free cluster bitmap (bit set = cluster in use), built on first use
+    uint32                   free_map[(FAT_FREE_MAP_CLUSTERS + 31) / 32];
+    uint32                   free_map_clusters;  // Clusters covered, 0 if not built
+    uint32                   free_map_count;     // Free clusters in the map
+    uint32                   free_map_hint;      // No free cluster below this one
+    int                      free_map_off;       // Build failed, not retried until remount
+#endif
 };
 
 struct fs_dir_list_status
@@ -8,7 +8,6 @@
 // Prototypes
 //-----------------------------------------------------------------------------
 int fatfs_cache_init(struct fatfs *fs, FL_FILE *file);
-int fatfs_cache_get_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 *pNextCluster);
-int fatfs_cache_set_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 nextCluster);
+uint32 fatfs_cache_map(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 want, uint32 *pCluster);
 
 #endif
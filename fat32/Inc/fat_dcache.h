@@ -0,0 +1,27 @@
+#ifndef __FAT_DCACHE_H__
+#define __FAT_DCACHE_H__
+
+#include "fat_defs.h"
+#include "fat_opts.h"
+#include "fat_access.h"
+
+//-----------------------------------------------------------------------------
+// Prototypes
+//-----------------------------------------------------------------------------
+#if FAT_DENTRY_ENTRIES
+void    fatfs_dcache_init(struct fatfs *fs);
+int     fatfs_dcache_lookup(struct fatfs *fs, uint32 parent, const char *name, struct fat_dir_entry *sfEntry);
+void    fatfs_dcache_insert(struct fatfs *fs, uint32 parent, const char *name, uint32 lba, uint16 offset, struct fat_dir_entry *sfEntry);
+int     fatfs_dcache_locate(struct fatfs *fs, uint32 parent, const char *shortname, uint32 *lba, uint16 *offset);
+void    fatfs_dcache_update(struct fatfs *fs, uint32 lba, uint16 offset, struct fat_dir_entry *sfEntry);
+void    fatfs_dcache_remove(struct fatfs *fs, uint32 parent, const char *shortname);
+#else
+#define fatfs_dcache_init(fs)
+#define fatfs_dcache_lookup(fs, parent, name, sfEntry)                  0
+#define fatfs_dcache_insert(fs, parent, name, lba, offset, sfEntry)
+#define fatfs_dcache_locate(fs, parent, shortname, lba, offset)         0
+#define fatfs_dcache_update(fs, lba, offset, sfEntry)
+#define fatfs_dcache_remove(fs, parent, shortname)
+#endif
+
+#endif
@@ -37,6 +37,14 @@ struct cluster_lookup
     uint32 CurrentCluster;
 };
 
+// Run of consecutive clusters in a file's cluster chain
+struct fat_extent
+{
+    uint32 index;       // Cluster index within the file of the first one
+    uint32 cluster;     // Disk cluster it is stored in
+    uint32 length;      // Clusters in the run
+};
+
 typedef struct sFL_FILE
 {
     uint32                  parentcluster;
@@ -48,12 +56,13 @@ typedef struct sFL_FILE
     char                    filename[FATFS_MAX_LONG_FILENAME];
     uint8                   shortfilename[11];
 
-#ifdef FAT_CLUSTER_CACHE_ENTRIES
-    uint32                  cluster_cache_idx[FAT_CLUSTER_CACHE_ENTRIES];
-    uint32                  cluster_cache_data[FAT_CLUSTER_CACHE_ENTRIES];
-#endif
+    // Extents of the cluster chain, covering cluster indexes 0 up to
+    // extent_clusters - 1
+    struct fat_extent       extents[FAT_EXTENT_ENTRIES];
+    uint32                  extent_count;
+    uint32                  extent_clusters;
 
-    // Cluster Lookup
+    // Cluster Lookup (used past the extents once they are all in use)
     struct cluster_lookup   last_fat_lookup;
 
     // Read/Write sector buffer
@@ -82,6 +91,8 @@ void                fl_init(void);
 void                fl_attach_locks(void (*lock)(void), void (*unlock)(void));
 int                 fl_attach_media(fn_diskio_read rd, fn_diskio_write wr);
 void                fl_shutdown(void);
+void                fl_fatstats(struct fat_stats *stats);
+int                 fl_diskfree(uint32 *total_kb, uint32 *free_kb);
 
 // Standard API
 void*               fl_fopen(const char *path, const char *modifiers);
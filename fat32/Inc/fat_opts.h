@@ -33,13 +33,42 @@
 // Max FAT sectors to buffer (min 1)
 // (mem used is FAT_BUFFERS * FAT_BUFFER_SECTORS * FAT_SECTOR_SIZE)
 #ifndef FAT_BUFFERS
-    #define FAT_BUFFERS                     1
+    #define FAT_BUFFERS                     8
 #endif
 
-// Size of cluster chain cache (can be undefined)
-// Mem used = FAT_CLUSTER_CACHE_ENTRIES * 4 * 2
-// Improves access speed considerably
-//#define FAT_CLUSTER_CACHE_ENTRIES         128
+// Hash buckets used to find a buffered FAT sector (power of 2)
+#ifndef FAT_BUFFER_HASH
+    #define FAT_BUFFER_HASH                 16
+#endif
+
+// Extents (runs of consecutive clusters) mapped per open file (min 1)
+// Mem used = FATFS_MAX_OPEN_FILES * FAT_EXTENT_ENTRIES * 12
+// Makes seeking within a file independent of its length
+#ifndef FAT_EXTENT_ENTRIES
+    #define FAT_EXTENT_ENTRIES              16
+#endif
+
+// Max clusters covered by the in-RAM free cluster bitmap (0 to disable)
+// Mem used = FAT_FREE_MAP_CLUSTERS / 8, larger volumes scan the FAT instead
+#ifndef FAT_FREE_MAP_CLUSTERS
+    #define FAT_FREE_MAP_CLUSTERS           16384
+#endif
+
+// Directory entries remembered for path lookups (0 to disable)
+// Mem used = FAT_DENTRY_ENTRIES * (FAT_DENTRY_NAME_LENGTH + 60)
+#ifndef FAT_DENTRY_ENTRIES
+    #define FAT_DENTRY_ENTRIES              16
+#endif
+
+// Longest name kept in the directory entry cache (including terminator)
+#ifndef FAT_DENTRY_NAME_LENGTH
+    #define FAT_DENTRY_NAME_LENGTH          24
+#endif
+
+// Hash buckets used to find a cached directory entry (power of 2)
+#ifndef FAT_DENTRY_HASH
+    #define FAT_DENTRY_HASH                 16
+#endif
 
 // Include support for writing files (1 / 0)?
 #ifndef FATFS_INC_WRITE_SUPPORT
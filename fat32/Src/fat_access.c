@@ -36,6 +36,7 @@
 #include <fat_write.h>
 #include <fat_string.h>
 #include <fat_misc.h>
+#include <fat_dcache.h>
 
 //-----------------------------------------------------------------------------
 // fatfs_init: Load FAT Parameters
@@ -57,6 +58,7 @@ int fatfs_init(struct fatfs *fs)
     fs->next_free_cluster = 0; // Invalid
 
     fatfs_fat_init(fs);
+    fatfs_dcache_init(fs);
 
     // Make sure we have a read function (write function is optional)
     if (!fs->disk_io.read_media)
@@ -165,6 +167,7 @@ int fatfs_init(struct fatfs *fs)
     if (fs->sectors_per_cluster != 0)
     {
         count_of_clusters = data_sectors / fs->sectors_per_cluster;
+        fs->cluster_limit = count_of_clusters + 2;
 
         if(count_of_clusters < 4085)
             // Volume is FAT12
@@ -416,6 +419,10 @@ uint32 fatfs_get_file_entry(struct fatfs *fs, uint32 Cluster, char *name_to_find
     int dotRequired = 0;
     struct fat_dir_entry *directoryEntry;
 
+    // Found recently?
+    if (fatfs_dcache_lookup(fs, Cluster, name_to_find, sfEntry))
+        return 1;
+
     fatfs_lfn_cache_init(&lfn, 1);
 
     // Main cluster following loop
@@ -451,6 +458,7 @@ uint32 fatfs_get_file_entry(struct fatfs *fs, uint32 Cluster, char *name_to_find
                     if (fatfs_compare_names(long_filename, name_to_find))
                     {
                         memcpy(sfEntry,directoryEntry,sizeof(struct fat_dir_entry));
+                        fatfs_dcache_insert(fs, Cluster, name_to_find, fs->currentsector.address, recordoffset, sfEntry);
                         return 1;
                     }
 
@@ -492,6 +500,7 @@ uint32 fatfs_get_file_entry(struct fatfs *fs, uint32 Cluster, char *name_to_find
                     if (fatfs_compare_names(short_filename, name_to_find))
                     {
                         memcpy(sfEntry,directoryEntry,sizeof(struct fat_dir_entry));
+                        fatfs_dcache_insert(fs, Cluster, name_to_find, fs->currentsector.address, recordoffset, sfEntry);
                         return 1;
                     }
 
@@ -609,6 +618,39 @@ int fatfs_update_timestamps(struct fat_dir_entry *directoryEntry, int create, in
 }
 #endif
 //-------------------------------------------------------------
+// fatfs_cached_sfn_entry: Load the sector holding SFN entry 'shortname'
+// of a directory into the working buffer if the directory entry cache
+// knows where it is. Returns the entry, or NULL to search for it.
+//-------------------------------------------------------------
+#if FATFS_INC_WRITE_SUPPORT
+static struct fat_dir_entry *fatfs_cached_sfn_entry(struct fatfs *fs, uint32 Cluster, char *shortname)
+{
+    struct fat_dir_entry *directoryEntry;
+    uint32 lba;
+    uint16 offset;
+
+    if (!fatfs_dcache_locate(fs, Cluster, shortname, &lba, &offset))
+        return NULL;
+
+    if (lba != fs->currentsector.address)
+    {
+        if (!fs->disk_io.read_media(lba, fs->currentsector.sector, 1))
+        {
+            fs->currentsector.address = FAT32_INVALID_CLUSTER;
+            return NULL;
+        }
+        fs->currentsector.address = lba;
+    }
+
+    // Check it is still there
+    directoryEntry = (struct fat_dir_entry*)(fs->currentsector.sector+offset);
+    if (!fatfs_entry_sfn_only(directoryEntry) || strncmp((const char*)directoryEntry->Name, shortname, 11) != 0)
+        return NULL;
+
+    return directoryEntry;
+}
+#endif
+//-------------------------------------------------------------
 // fatfs_update_file_length: Find a SFN entry and update it
 // NOTE: shortname is XXXXXXXXYYY not XXXXXXXX.YYY
 //-------------------------------------------------------------
@@ -624,6 +666,24 @@ int fatfs_update_file_length(struct fatfs *fs, uint32 Cluster, char *shortname,
     if (!fs->disk_io.write_media)
         return 0;
 
+    // Go straight to the entry if its location is cached
+    directoryEntry = fatfs_cached_sfn_entry(fs, Cluster, shortname);
+    if (directoryEntry)
+    {
+        directoryEntry->FileSize = FAT_HTONL(fileLength);
+
+#if FATFS_INC_TIME_DATE_SUPPORT
+        // Update access / modify time & date
+        fatfs_update_timestamps(directoryEntry, 0, 1, 1);
+#endif
+
+        recordoffset = (uint16)((uint8*)directoryEntry - fs->currentsector.sector);
+        fatfs_dcache_update(fs, fs->currentsector.address, recordoffset, directoryEntry);
+
+        // Write sector back
+        return fs->disk_io.write_media(fs->currentsector.address, fs->currentsector.sector, 1);
+    }
+
     // Main cluster following loop
     while (1)
     {
@@ -664,6 +724,7 @@ int fatfs_update_file_length(struct fatfs *fs, uint32 Cluster, char *shortname,
 
                         // Update sfn entry
                         memcpy((uint8*)(fs->currentsector.sector+recordoffset), (uint8*)directoryEntry, sizeof(struct fat_dir_entry));
+                        fatfs_dcache_update(fs, fs->currentsector.address, recordoffset, directoryEntry);
 
                         // Write sector back
                         return fs->disk_io.write_media(fs->currentsector.address, fs->currentsector.sector, 1);
@@ -694,6 +755,24 @@ int fatfs_mark_file_deleted(struct fatfs *fs, uint32 Cluster, char *shortname)
     if (!fs->disk_io.write_media)
         return 0;
 
+    // Forget every name cached for the entry, going straight to it if
+    // its location was known
+    directoryEntry = fatfs_cached_sfn_entry(fs, Cluster, shortname);
+    fatfs_dcache_remove(fs, Cluster, shortname);
+    if (directoryEntry)
+    {
+        // Mark as deleted
+        directoryEntry->Name[0] = FILE_HEADER_DELETED;
+
+#if FATFS_INC_TIME_DATE_SUPPORT
+        // Update access / modify time & date
+        fatfs_update_timestamps(directoryEntry, 0, 1, 1);
+#endif
+
+        // Write sector back
+        return fs->disk_io.write_media(fs->currentsector.address, fs->currentsector.sector, 1);
+    }
+
     // Main cluster following loop
     while (1)
     {
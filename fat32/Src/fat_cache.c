@@ -32,61 +32,129 @@
 #include <string.h>
 //#include <integer.h>
 #include <fat_cache.h>
+#include <fat_table.h>
 
-// Per file cluster chain caching used to improve performance.
-// This does not have to be enabled for architectures with low
-// memory space.
+// Per file map of the cluster chain as a list of extents (runs of
+// consecutive clusters), built as the chain is walked. Once built, the
+// cluster for any offset is a binary search away, and a run tells the
+// caller how many clusters can be transferred in one go.
 
 //-----------------------------------------------------------------------------
 // fatfs_cache_init:
 //-----------------------------------------------------------------------------
 int fatfs_cache_init(struct fatfs *fs, FL_FILE *file)
 {
-#ifdef FAT_CLUSTER_CACHE_ENTRIES
-    int i;
-
-    for (i=0;i<FAT_CLUSTER_CACHE_ENTRIES;i++)
-    {
-        file->cluster_cache_idx[i] = 0xFFFFFFFF; // Not used
-        file->cluster_cache_data[i] = 0;
-    }
-#endif
+    file->extent_count = 0;
+    file->extent_clusters = 0;
 
     return 1;
 }
 //-----------------------------------------------------------------------------
-// fatfs_cache_get_next_cluster:
+// fatfs_cache_extend: Add the next cluster of the chain to the map. Returns
+// 1 if added, 0 at the end of the chain and -1 if the map is full.
 //-----------------------------------------------------------------------------
-int fatfs_cache_get_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 *pNextCluster)
+static int fatfs_cache_extend(struct fatfs *fs, FL_FILE *file)
 {
-#ifdef FAT_CLUSTER_CACHE_ENTRIES
-    uint32 slot = clusterIdx % FAT_CLUSTER_CACHE_ENTRIES;
+    struct fat_extent *ext = NULL;
+    uint32 next;
+
+    if (file->extent_count == 0)
+        next = file->startcluster;
+    else
+    {
+        ext = &file->extents[file->extent_count - 1];
+        next = fatfs_find_next_cluster(fs, ext->cluster + ext->length - 1);
+    }
+
+    if (next == 0 || next == FAT32_LAST_CLUSTER)
+        return 0;
 
-    if (file->cluster_cache_idx[slot] == clusterIdx)
+    // Grow the last run, or start a new one
+    if (ext && ext->cluster + ext->length == next)
+        ext->length++;
+    else if (file->extent_count < FAT_EXTENT_ENTRIES)
     {
-        *pNextCluster = file->cluster_cache_data[slot];
-        return 1;
+        ext = &file->extents[file->extent_count++];
+        ext->index = file->extent_clusters;
+        ext->cluster = next;
+        ext->length = 1;
     }
-#endif
+    else
+        return -1;
 
-    return 0;
+    file->extent_clusters++;
+    return 1;
 }
 //-----------------------------------------------------------------------------
-// fatfs_cache_set_next_cluster:
+// fatfs_cache_map: Find the disk cluster holding cluster index clusterIdx of
+// a file. Returns how many consecutive clusters start there (at most 'want'),
+// or 0 if the chain is shorter than clusterIdx.
 //-----------------------------------------------------------------------------
-int fatfs_cache_set_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 nextCluster)
+uint32 fatfs_cache_map(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 want, uint32 *pCluster)
 {
-#ifdef FAT_CLUSTER_CACHE_ENTRIES
-    uint32 slot = clusterIdx % FAT_CLUSTER_CACHE_ENTRIES;
+    struct fat_extent *ext;
+    uint32 lo, hi, mid;
+    uint32 i, cluster, run;
+    int res = 1;
+
+    if (want == 0)
+        want = 1;
+
+    // Map the chain far enough to cover the request
+    while (file->extent_clusters < clusterIdx + want)
+        if ((res = fatfs_cache_extend(fs, file)) <= 0)
+            break;
 
-    if (file->cluster_cache_idx[slot] == clusterIdx)
-        file->cluster_cache_data[slot] = nextCluster;
+    if (clusterIdx < file->extent_clusters)
+    {
+        // Binary search for the last extent starting at or before clusterIdx
+        lo = 0;
+        hi = file->extent_count - 1;
+        while (lo < hi)
+        {
+            mid = (lo + hi + 1) / 2;
+            if (file->extents[mid].index <= clusterIdx)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+
+        ext = &file->extents[lo];
+        *pCluster = ext->cluster + (clusterIdx - ext->index);
+        run = ext->length - (clusterIdx - ext->index);
+        return (run < want) ? run : want;
+    }
+
+    // Past the end of the chain?
+    if (res == 0)
+        return 0;
+
+    // The map is full; walk on from the last lookup or the end of the map
+    ext = &file->extents[file->extent_count - 1];
+    if (file->last_fat_lookup.ClusterIdx != 0xFFFFFFFF &&
+        file->last_fat_lookup.ClusterIdx >= file->extent_clusters &&
+        file->last_fat_lookup.ClusterIdx <= clusterIdx)
+    {
+        i = file->last_fat_lookup.ClusterIdx;
+        cluster = file->last_fat_lookup.CurrentCluster;
+    }
     else
     {
-        file->cluster_cache_idx[slot] = clusterIdx;
-        file->cluster_cache_data[slot] = nextCluster;
+        i = file->extent_clusters - 1;
+        cluster = ext->cluster + ext->length - 1;
     }
-#endif
 
+    for ( ;i<clusterIdx; i++)
+    {
+        cluster = fatfs_find_next_cluster(fs, cluster);
+        if (cluster == 0 || cluster == FAT32_LAST_CLUSTER)
+            return 0;
+    }
+
+    // Record current cluster lookup details
+    file->last_fat_lookup.ClusterIdx = clusterIdx;
+    file->last_fat_lookup.CurrentCluster = cluster;
+
+    *pCluster = cluster;
     return 1;
 }
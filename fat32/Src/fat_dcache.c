@@ -0,0 +1,281 @@
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//                            FAT16/32 File IO Library
+//                                    V2.6
+//                              Ultra-Embedded.com
+//                            Copyright 2003 - 2012
+//
+//                         Email: admin@ultra-embedded.com
+//
+//                                License: GPL
+//   If you would like a version with a more permissive license for use in
+//   closed source commercial applications please contact me for details.
+//-----------------------------------------------------------------------------
+//
+// This file is part of FAT File IO Library.
+//
+// FAT File IO Library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// FAT File IO Library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with FAT File IO Library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include <fat_defs.h>
+#include <fat_access.h>
+#include <fat_dcache.h>
+
+#if FAT_DENTRY_ENTRIES
+
+#if FAT_DENTRY_HASH < 1 || (FAT_DENTRY_HASH & (FAT_DENTRY_HASH - 1)) != 0
+    #error "FAT_DENTRY_HASH must be a power of 2"
+#endif
+
+// Names recently found in each directory, so that opening the same paths
+// again does not read and compare every entry of every directory on the
+// way. Only names actually found are kept (a miss always searches the
+// directory), and the entries for a file are dropped when it is deleted or
+// a file of the same short name is created.
+
+#define DENTRY_HASH(parent, hash)   (((parent) ^ (hash)) & (FAT_DENTRY_HASH - 1))
+
+//-----------------------------------------------------------------------------
+// fatfs_dcache_key: Fold a name to lower case and hash it (FNV-1a). Returns
+// 0 if the name is too long to cache.
+//-----------------------------------------------------------------------------
+static int fatfs_dcache_key(const char *name, char *key, uint32 *hash)
+{
+    uint32 h = 2166136261UL;
+    int i;
+
+    for (i=0;name[i];i++)
+    {
+        if (i >= FAT_DENTRY_NAME_LENGTH - 1)
+            return 0;
+
+        key[i] = (name[i] >= 'A' && name[i] <= 'Z') ? name[i] - 'A' + 'a' : name[i];
+        h = (h ^ (uint8)key[i]) * 16777619UL;
+    }
+
+    key[i] = '\0';
+    *hash = h;
+    return 1;
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_unhash: Remove an entry from its hash chain (if it is on one)
+//-----------------------------------------------------------------------------
+static void fatfs_dcache_unhash(struct fatfs *fs, struct fat_dentry *pent)
+{
+    struct fat_dentry **link = &fs->dentry_hash[DENTRY_HASH(pent->parent, pent->hash)];
+
+    while (*link && *link != pent)
+        link = &(*link)->hnext;
+
+    if (*link)
+        *link = pent->hnext;
+    pent->hnext = NULL;
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_move: Move an entry to the head (most recently used) or the
+// tail (next reused) of the LRU list
+//-----------------------------------------------------------------------------
+static void fatfs_dcache_move(struct fatfs *fs, struct fat_dentry *pent, int tail)
+{
+    // Unlink
+    if (pent->prev)
+        pent->prev->next = pent->next;
+    else
+        fs->dentry_head = pent->next;
+
+    if (pent->next)
+        pent->next->prev = pent->prev;
+    else
+        fs->dentry_tail = pent->prev;
+
+    if (tail)
+    {
+        pent->next = NULL;
+        pent->prev = fs->dentry_tail;
+        if (fs->dentry_tail)
+            fs->dentry_tail->next = pent;
+        else
+            fs->dentry_head = pent;
+        fs->dentry_tail = pent;
+    }
+    else
+    {
+        pent->prev = NULL;
+        pent->next = fs->dentry_head;
+        if (fs->dentry_head)
+            fs->dentry_head->prev = pent;
+        else
+            fs->dentry_tail = pent;
+        fs->dentry_head = pent;
+    }
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_find: Find the entry for a folded name in a directory
+//-----------------------------------------------------------------------------
+static struct fat_dentry *fatfs_dcache_find(struct fatfs *fs, uint32 parent, const char *key, uint32 hash)
+{
+    struct fat_dentry *pent = fs->dentry_hash[DENTRY_HASH(parent, hash)];
+
+    while (pent && (pent->hash != hash || pent->parent != parent || strcmp(pent->name, key) != 0))
+        pent = pent->hnext;
+
+    return pent;
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_init: Forget all entries (on mount or format)
+//-----------------------------------------------------------------------------
+void fatfs_dcache_init(struct fatfs *fs)
+{
+    int i;
+
+    for (i=0;i<FAT_DENTRY_HASH;i++)
+        fs->dentry_hash[i] = NULL;
+
+    // All entries unused, in the LRU list in order
+    for (i=0;i<FAT_DENTRY_ENTRIES;i++)
+    {
+        fs->dentries[i].name[0] = '\0';
+        fs->dentries[i].hnext = NULL;
+        fs->dentries[i].prev = (i > 0) ? &fs->dentries[i - 1] : NULL;
+        fs->dentries[i].next = (i < FAT_DENTRY_ENTRIES - 1) ? &fs->dentries[i + 1] : NULL;
+    }
+
+    fs->dentry_head = &fs->dentries[0];
+    fs->dentry_tail = &fs->dentries[FAT_DENTRY_ENTRIES - 1];
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_lookup: Get the SFN entry for a name in a directory if it
+// is cached
+//-----------------------------------------------------------------------------
+int fatfs_dcache_lookup(struct fatfs *fs, uint32 parent, const char *name, struct fat_dir_entry *sfEntry)
+{
+    char key[FAT_DENTRY_NAME_LENGTH];
+    struct fat_dentry *pent;
+    uint32 hash;
+
+    if (!fatfs_dcache_key(name, key, &hash))
+        return 0;
+
+    pent = fatfs_dcache_find(fs, parent, key, hash);
+    if (!pent)
+    {
+        fs->fat_stats.dentry_misses++;
+        return 0;
+    }
+
+    fs->fat_stats.dentry_hits++;
+    if (pent != fs->dentry_head)
+        fatfs_dcache_move(fs, pent, 0);
+
+    memcpy(sfEntry, &pent->entry, sizeof(struct fat_dir_entry));
+    return 1;
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_insert: Remember where a name was found in a directory
+//-----------------------------------------------------------------------------
+void fatfs_dcache_insert(struct fatfs *fs, uint32 parent, const char *name, uint32 lba, uint16 offset, struct fat_dir_entry *sfEntry)
+{
+    char key[FAT_DENTRY_NAME_LENGTH];
+    struct fat_dentry *pent;
+    uint32 hash;
+
+    if (!fatfs_dcache_key(name, key, &hash))
+        return;
+
+    // Reuse the entry for this name, else the least recently used one
+    pent = fatfs_dcache_find(fs, parent, key, hash);
+    if (!pent)
+    {
+        pent = fs->dentry_tail;
+        if (pent->name[0])
+            fatfs_dcache_unhash(fs, pent);
+
+        pent->parent = parent;
+        pent->hash = hash;
+        strcpy(pent->name, key);
+
+        pent->hnext = fs->dentry_hash[DENTRY_HASH(parent, hash)];
+        fs->dentry_hash[DENTRY_HASH(parent, hash)] = pent;
+    }
+
+    pent->lba = lba;
+    pent->offset = offset;
+    memcpy(&pent->entry, sfEntry, sizeof(struct fat_dir_entry));
+
+    if (pent != fs->dentry_head)
+        fatfs_dcache_move(fs, pent, 0);
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_locate: Find where the SFN entry 'shortname' of a directory
+// is on disk, if any name of it is cached.
+// NOTE: shortname is XXXXXXXXYYY not XXXXXXXX.YYY
+//-----------------------------------------------------------------------------
+int fatfs_dcache_locate(struct fatfs *fs, uint32 parent, const char *shortname, uint32 *lba, uint16 *offset)
+{
+    int i;
+
+    for (i=0;i<FAT_DENTRY_ENTRIES;i++)
+    {
+        struct fat_dentry *pent = &fs->dentries[i];
+
+        if (pent->name[0] && pent->parent == parent && memcmp(pent->entry.Name, shortname, 11) == 0)
+        {
+            *lba = pent->lba;
+            *offset = pent->offset;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_update: Refresh the cached copies of the SFN entry at a
+// location after it has been changed on disk
+//-----------------------------------------------------------------------------
+void fatfs_dcache_update(struct fatfs *fs, uint32 lba, uint16 offset, struct fat_dir_entry *sfEntry)
+{
+    int i;
+
+    for (i=0;i<FAT_DENTRY_ENTRIES;i++)
+    {
+        struct fat_dentry *pent = &fs->dentries[i];
+
+        if (pent->name[0] && pent->lba == lba && pent->offset == offset)
+            memcpy(&pent->entry, sfEntry, sizeof(struct fat_dir_entry));
+    }
+}
+//-----------------------------------------------------------------------------
+// fatfs_dcache_remove: Forget every name cached for the SFN entry
+// 'shortname' of a directory
+// NOTE: shortname is XXXXXXXXYYY not XXXXXXXX.YYY
+//-----------------------------------------------------------------------------
+void fatfs_dcache_remove(struct fatfs *fs, uint32 parent, const char *shortname)
+{
+    int i;
+
+    for (i=0;i<FAT_DENTRY_ENTRIES;i++)
+    {
+        struct fat_dentry *pent = &fs->dentries[i];
+
+        if (pent->name[0] && pent->parent == parent && memcmp(pent->entry.Name, shortname, 11) == 0)
+        {
+            fatfs_dcache_unhash(fs, pent);
+            pent->name[0] = '\0';
+            fatfs_dcache_move(fs, pent, 1);
+        }
+    }
+}
+#endif
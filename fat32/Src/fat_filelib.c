@@ -551,67 +551,23 @@ static uint32 _read_sectors(FL_FILE* file, uint32 offset, uint8 *buffer, uint32
     uint32 Sector = 0;
     uint32 ClusterIdx = 0;
     uint32 Cluster = 0;
-    uint32 i;
+    uint32 Run;
     uint32 lba;
 
     // Find cluster index within file & sector with cluster
     ClusterIdx = offset / _fs.sectors_per_cluster;
     Sector = offset - (ClusterIdx * _fs.sectors_per_cluster);
 
-    // Limit number of sectors read to the number remaining in this cluster
-    if ((Sector + count) > _fs.sectors_per_cluster)
-        count = _fs.sectors_per_cluster - Sector;
-
-    // Quick lookup for next link in the chain
-    if (ClusterIdx == file->last_fat_lookup.ClusterIdx)
-        Cluster = file->last_fat_lookup.CurrentCluster;
-    // Else walk the chain
-    else
-    {
-        // Starting from last recorded cluster?
-        if (ClusterIdx && ClusterIdx == file->last_fat_lookup.ClusterIdx + 1)
-        {
-            i = file->last_fat_lookup.ClusterIdx;
-            Cluster = file->last_fat_lookup.CurrentCluster;
-        }
-        // Start searching from the beginning..
-        else
-        {
-            // Set start of cluster chain to initial value
-            i = 0;
-            Cluster = file->startcluster;
-        }
-
-        // Follow chain to find cluster to read
-        for ( ;i<ClusterIdx; i++)
-        {
-            uint32 nextCluster;
-
-            // Does the entry exist in the cache?
-            if (!fatfs_cache_get_next_cluster(&_fs, file, i, &nextCluster))
-            {
-                // Scan file linked list to find next entry
-                nextCluster = fatfs_find_next_cluster(&_fs, Cluster);
-
-                // Push entry into cache
-                fatfs_cache_set_next_cluster(&_fs, file, i, nextCluster);
-            }
-
-            Cluster = nextCluster;
-        }
-
-        // Record current cluster lookup details (if valid)
-        if (Cluster != FAT32_LAST_CLUSTER)
-        {
-            file->last_fat_lookup.CurrentCluster = Cluster;
-            file->last_fat_lookup.ClusterIdx = ClusterIdx;
-        }
-    }
-
-    // If end of cluster chain then return false
-    if (Cluster == FAT32_LAST_CLUSTER)
+    // Find the disk cluster from the file's extent map, with the number of
+    // clusters after it that are consecutive on disk
+    Run = fatfs_cache_map(&_fs, file, ClusterIdx, (Sector + count + _fs.sectors_per_cluster - 1) / _fs.sectors_per_cluster, &Cluster);
+    if (!Run)
         return 0;
 
+    // Limit number of sectors read to the number remaining in this run
+    if ((Sector + count) > Run * _fs.sectors_per_cluster)
+        count = Run * _fs.sectors_per_cluster - Sector;
+
     // Calculate sector address
     lba = fatfs_lba_of_cluster(&_fs, Cluster) + Sector;
 
@@ -686,6 +642,39 @@ void fl_shutdown(void)
     FL_UNLOCK(&_fs);
 }
 //-----------------------------------------------------------------------------
+// fl_fatstats: Copy the FAT sector cache counters
+//-----------------------------------------------------------------------------
+void fl_fatstats(struct fat_stats *stats)
+{
+    // If first call to library, initialise
+    CHECK_FL_INIT();
+
+    FL_LOCK(&_fs);
+    *stats = _fs.fat_stats;
+    FL_UNLOCK(&_fs);
+}
+//-----------------------------------------------------------------------------
+// fl_diskfree: Get the size of the volume and the space free on it in KB
+//-----------------------------------------------------------------------------
+int fl_diskfree(uint32 *total_kb, uint32 *free_kb)
+{
+    uint32 clusters;
+
+    // If first call to library, initialise
+    CHECK_FL_INIT();
+
+    if (!_filelib_valid)
+        return -1;
+
+    FL_LOCK(&_fs);
+    clusters = fatfs_count_free_clusters(&_fs);
+    *total_kb = (_fs.cluster_limit - 2) * _fs.sectors_per_cluster / (1024 / FAT_SECTOR_SIZE);
+    *free_kb = clusters * _fs.sectors_per_cluster / (1024 / FAT_SECTOR_SIZE);
+    FL_UNLOCK(&_fs);
+
+    return 0;
+}
+//-----------------------------------------------------------------------------
 // fopen: Open or Create a file for reading or writing
 //-----------------------------------------------------------------------------
 void* fl_fopen(const char *path, const char *mode)
@@ -810,7 +799,8 @@ static uint32 _write_sectors(FL_FILE* file, uint32 offset, uint8 *buf, uint32 co
     uint32 ClusterIdx = 0;
     uint32 Cluster = 0;
     uint32 LastCluster = FAT32_LAST_CLUSTER;
-    uint32 i;
+    uint32 Run;
+    uint32 Want;
     uint32 lba;
     uint32 TotalWriteCount = count;
 
@@ -818,68 +808,30 @@ static uint32 _write_sectors(FL_FILE* file, uint32 offset, uint8 *buf, uint32 co
     ClusterIdx = offset / _fs.sectors_per_cluster;
     SectorNumber = offset - (ClusterIdx * _fs.sectors_per_cluster);
 
-    // Limit number of sectors written to the number remaining in this cluster
-    if ((SectorNumber + count) > _fs.sectors_per_cluster)
-        count = _fs.sectors_per_cluster - SectorNumber;
-
-    // Quick lookup for next link in the chain
-    if (ClusterIdx == file->last_fat_lookup.ClusterIdx)
-        Cluster = file->last_fat_lookup.CurrentCluster;
-    // Else walk the chain
-    else
+    // Find the disk cluster from the file's extent map, with the number of
+    // clusters after it that are consecutive on disk
+    Want = (SectorNumber + count + _fs.sectors_per_cluster - 1) / _fs.sectors_per_cluster;
+    Run = fatfs_cache_map(&_fs, file, ClusterIdx, Want, &Cluster);
+    if (!Run)
     {
-        // Starting from last recorded cluster?
-        if (ClusterIdx && ClusterIdx == file->last_fat_lookup.ClusterIdx + 1)
-        {
-            i = file->last_fat_lookup.ClusterIdx;
-            Cluster = file->last_fat_lookup.CurrentCluster;
-        }
-        // Start searching from the beginning..
-        else
-        {
-            // Set start of cluster chain to initial value
-            i = 0;
-            Cluster = file->startcluster;
-        }
-
-        // Follow chain to find cluster to read
-        for ( ;i<ClusterIdx; i++)
-        {
-            uint32 nextCluster;
-
-            // Does the entry exist in the cache?
-            if (!fatfs_cache_get_next_cluster(&_fs, file, i, &nextCluster))
-            {
-                // Scan file linked list to find next entry
-                nextCluster = fatfs_find_next_cluster(&_fs, Cluster);
-
-                // Push entry into cache
-                fatfs_cache_set_next_cluster(&_fs, file, i, nextCluster);
-            }
-
-            LastCluster = Cluster;
-            Cluster = nextCluster;
-
-            // Dont keep following a dead end
-            if (Cluster == FAT32_LAST_CLUSTER)
-                break;
-        }
-
-        // If we have reached the end of the chain, allocate more!
-        if (Cluster == FAT32_LAST_CLUSTER)
-        {
-            // Add some more cluster(s) to the last good cluster chain
-            if (!fatfs_add_free_space(&_fs, &LastCluster,  (TotalWriteCount + _fs.sectors_per_cluster -1) / _fs.sectors_per_cluster))
-                return 0;
+        // Past the end of the chain, so find its last cluster
+        if (ClusterIdx == 0 || !fatfs_cache_map(&_fs, file, ClusterIdx - 1, 1, &LastCluster))
+            return 0;
 
-            Cluster = LastCluster;
-        }
+        // Add some more cluster(s) to the last good cluster chain
+        if (!fatfs_add_free_space(&_fs, &LastCluster,  (TotalWriteCount + _fs.sectors_per_cluster -1) / _fs.sectors_per_cluster))
+            return 0;
 
-        // Record current cluster lookup details
-        file->last_fat_lookup.CurrentCluster = Cluster;
-        file->last_fat_lookup.ClusterIdx = ClusterIdx;
+        // The new clusters are usually consecutive too
+        Run = fatfs_cache_map(&_fs, file, ClusterIdx, Want, &Cluster);
+        if (!Run)
+            return 0;
     }
 
+    // Limit number of sectors written to the number remaining in this run
+    if ((SectorNumber + count) > Run * _fs.sectors_per_cluster)
+        count = Run * _fs.sectors_per_cluster - SectorNumber;
+
     // Calculate write address
     lba = fatfs_lba_of_cluster(&_fs, Cluster) + SectorNumber;
 
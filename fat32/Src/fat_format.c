@@ -37,6 +37,7 @@
 #include <fat_string.h>
 #include <fat_misc.h>
 #include <fat_format.h>
+#include <fat_dcache.h>
 
 #if FATFS_INC_FORMAT_SUPPORT
 
@@ -431,6 +432,7 @@ int fatfs_format_fat16(struct fatfs *fs, uint32 volume_sectors, const char *name
     fs->next_free_cluster = 0; // Invalid
 
     fatfs_fat_init(fs);
+    fatfs_dcache_init(fs);
 
     // Make sure we have read + write functions
     if (!fs->disk_io.read_media || !fs->disk_io.write_media)
@@ -459,6 +461,9 @@ int fatfs_format_fat16(struct fatfs *fs, uint32 volume_sectors, const char *name
     // The address of the first data cluster on this volume
     fs->cluster_begin_lba = fs->fat_begin_lba + (fs->num_of_fats * fs->fat_sectors);
 
+    // Clusters fill the rest of the volume after the root directory
+    fs->cluster_limit = ((volume_sectors - fs->rootdir_first_sector - fs->rootdir_sectors) / fs->sectors_per_cluster) + 2;
+
     // Initialise FAT sectors
     if (!fatfs_erase_fat(fs, 0))
         return 0;
@@ -480,6 +485,7 @@ int fatfs_format_fat32(struct fatfs *fs, uint32 volume_sectors, const char *name
     fs->next_free_cluster = 0; // Invalid
 
     fatfs_fat_init(fs);
+    fatfs_dcache_init(fs);
 
     // Make sure we have read + write functions
     if (!fs->disk_io.read_media || !fs->disk_io.write_media)
@@ -504,6 +510,9 @@ int fatfs_format_fat32(struct fatfs *fs, uint32 volume_sectors, const char *name
     // The address of the first data cluster on this volume
     fs->cluster_begin_lba = fs->fat_begin_lba + (fs->num_of_fats * fs->fat_sectors);
 
+    // Clusters fill the rest of the volume
+    fs->cluster_limit = ((volume_sectors - fs->cluster_begin_lba) / fs->sectors_per_cluster) + 2;
+
     // Initialise FSInfo sector
     if (!fatfs_create_fsinfo_sector(fs, fs->fs_info_sector))
         return 0;
@@ -42,10 +42,18 @@
     #define FAT_BUFFER_SECTORS 1
 #endif
 
+#ifndef FAT_BUFFER_HASH
+    #define FAT_BUFFER_HASH 16
+#endif
+
 #if FAT_BUFFERS < 1 || FAT_BUFFER_SECTORS < 1
     #error "<fat_BUFFERS & FAT_BUFFER_SECTORS must be at least 1"
 #endif
 
+#if FAT_BUFFER_HASH < 1 || (FAT_BUFFER_HASH & (FAT_BUFFER_HASH - 1)) != 0
+    #error "FAT_BUFFER_HASH must be a power of 2"
+#endif
+
 //-----------------------------------------------------------------------------
 //                            FAT Sector Buffer
 //-----------------------------------------------------------------------------
@@ -54,6 +62,10 @@
 #define FAT16_GET_16BIT_WORD(pbuf, location)        ( GET_16BIT_WORD(pbuf->ptr, location) )
 #define FAT16_SET_16BIT_WORD(pbuf, location, value) { SET_16BIT_WORD(pbuf->ptr, location, value); pbuf->dirty = 1; }
 
+#define FAT_HASH(address)       (((address) / FAT_BUFFER_SECTORS) & (FAT_BUFFER_HASH - 1))
+
+#define FREE_MAP_WORDS(fs)      (((fs)->free_map_clusters + 31) / 32)
+
 //-----------------------------------------------------------------------------
 // fatfs_fat_init:
 //-----------------------------------------------------------------------------
@@ -61,138 +73,420 @@ void fatfs_fat_init(struct fatfs *fs)
 {
     int i;
 
-    // FAT buffer chain head
+    // FAT buffer LRU list and hash chains
     fs->fat_buffer_head = NULL;
+    fs->fat_buffer_tail = NULL;
+
+    for (i=0;i<FAT_BUFFER_HASH;i++)
+        fs->fat_hash[i] = NULL;
 
     for (i=0;i<FAT_BUFFERS;i++)
     {
         // Initialise buffers to invalid
         fs->fat_buffers[i].address = FAT32_INVALID_CLUSTER;
         fs->fat_buffers[i].dirty = 0;
-        memset(fs->fat_buffers[i].sector, 0x00, sizeof(fs->fat_buffers[i].sector));
+        fs->fat_buffers[i].sector = fs->fat_data[i];
+        memset(fs->fat_data[i], 0x00, sizeof(fs->fat_data[i]));
         fs->fat_buffers[i].ptr = NULL;
+        fs->fat_buffers[i].hnext = NULL;
 
         // Add to head of queue
+        fs->fat_buffers[i].prev = NULL;
         fs->fat_buffers[i].next = fs->fat_buffer_head;
+        if (fs->fat_buffer_head)
+            fs->fat_buffer_head->prev = &fs->fat_buffers[i];
+        else
+            fs->fat_buffer_tail = &fs->fat_buffers[i];
         fs->fat_buffer_head = &fs->fat_buffers[i];
     }
+
+#if FAT_FREE_MAP_CLUSTERS
+    // Free cluster bitmap is rebuilt when next needed
+    fs->free_map_clusters = 0;
+    fs->free_map_count = 0;
+    fs->free_map_hint = 0;
+    fs->free_map_off = 0;
+#endif
+
+    memset(&fs->fat_stats, 0x00, sizeof(fs->fat_stats));
 }
 //-----------------------------------------------------------------------------
-// fatfs_fat_writeback: Writeback 'dirty' FAT sectors to disk
+// fatfs_fat_lookup: Find the buffer holding the sectors starting at address
 //-----------------------------------------------------------------------------
-static int fatfs_fat_writeback(struct fatfs *fs, struct fat_buffer *pcur)
+static struct fat_cache_buf *fatfs_fat_lookup(struct fatfs *fs, uint32 address)
 {
-    if (pcur)
-    {
-        // Writeback sector if changed
-        if (pcur->dirty)
-        {
-            if (fs->disk_io.write_media)
-            {
-                uint32 sectors = FAT_BUFFER_SECTORS;
-                uint32 offset = pcur->address - fs->fat_begin_lba;
+    struct fat_cache_buf *pcur = fs->fat_hash[FAT_HASH(address)];
 
-                // Limit to sectors used for the FAT
-                if ((offset + FAT_BUFFER_SECTORS) <= fs->fat_sectors)
-                    sectors = FAT_BUFFER_SECTORS;
-                else
-                    sectors = fs->fat_sectors - offset;
+    while (pcur && pcur->address != address)
+        pcur = pcur->hnext;
 
-                if (!fs->disk_io.write_media(pcur->address, pcur->sector, sectors))
-                    return 0;
-            }
+    return pcur;
+}
+//-----------------------------------------------------------------------------
+// fatfs_fat_unhash: Remove a buffer from its hash chain (if it is on one)
+//-----------------------------------------------------------------------------
+static void fatfs_fat_unhash(struct fatfs *fs, struct fat_cache_buf *pbuf)
+{
+    struct fat_cache_buf **link = &fs->fat_hash[FAT_HASH(pbuf->address)];
 
-            pcur->dirty = 0;
-        }
+    while (*link && *link != pbuf)
+        link = &(*link)->hnext;
 
-        return 1;
-    }
+    if (*link)
+        *link = pbuf->hnext;
+    pbuf->hnext = NULL;
+}
+//-----------------------------------------------------------------------------
+// fatfs_fat_unlink: Remove a buffer from the LRU list
+//-----------------------------------------------------------------------------
+static void fatfs_fat_unlink(struct fatfs *fs, struct fat_cache_buf *pbuf)
+{
+    if (pbuf->prev)
+        pbuf->prev->next = pbuf->next;
     else
-        return 0;
+        fs->fat_buffer_head = pbuf->next;
+
+    if (pbuf->next)
+        pbuf->next->prev = pbuf->prev;
+    else
+        fs->fat_buffer_tail = pbuf->prev;
 }
 //-----------------------------------------------------------------------------
-// fatfs_fat_read_sector: Read a FAT sector
+// fatfs_fat_swap_slots: Exchange the data slots of two buffers
 //-----------------------------------------------------------------------------
-static struct fat_buffer *fatfs_fat_read_sector(struct fatfs *fs, uint32 sector)
+static void fatfs_fat_swap_slots(struct fat_cache_buf *a, struct fat_cache_buf *b)
 {
-    struct fat_buffer *last = NULL;
-    struct fat_buffer *pcur = fs->fat_buffer_head;
+    uint32 *pa = (uint32 *)a->sector;
+    uint32 *pb = (uint32 *)b->sector;
+    uint8 *slot;
+    uint32 tmp;
+    int i;
 
-    // Itterate through sector buffer list
-    while (pcur)
+    for (i=0;i<(FAT_SECTOR_SIZE * FAT_BUFFER_SECTORS) / 4;i++)
     {
-        // Sector within this buffer?
-        if ((sector >= pcur->address) && (sector < (pcur->address + FAT_BUFFER_SECTORS)))
-            break;
+        tmp = pa[i];
+        pa[i] = pb[i];
+        pb[i] = tmp;
+    }
 
-        // End of list?
-        if (pcur->next == NULL)
+    slot = a->sector;
+    a->sector = b->sector;
+    b->sector = slot;
+}
+//-----------------------------------------------------------------------------
+// fatfs_fat_writeback: Writeback a 'dirty' FAT buffer to disk, together with
+// any dirty buffers holding the sectors either side of it, in one write
+//-----------------------------------------------------------------------------
+static int fatfs_fat_writeback(struct fatfs *fs, struct fat_cache_buf *pcur)
+{
+    struct fat_cache_buf *run[FAT_BUFFERS];
+    struct fat_cache_buf *pbuf;
+    uint32 first;
+    uint32 sectors;
+    int count;
+    int i, j;
+
+    if (!pcur)
+        return 0;
+
+    // Writeback sector if changed
+    if (!pcur->dirty)
+        return 1;
+
+    // Find the dirty buffers around this one, lowest address first
+    first = pcur->address;
+    count = 1;
+    if (first >= fs->fat_begin_lba)
+    {
+        while (first >= fs->fat_begin_lba + FAT_BUFFER_SECTORS)
         {
-            // Remove buffer from list
-            if (last)
-                last->next = NULL;
-            // We the first and last buffer in the chain?
-            else
-                fs->fat_buffer_head = NULL;
+            pbuf = fatfs_fat_lookup(fs, first - FAT_BUFFER_SECTORS);
+            if (!pbuf || !pbuf->dirty)
+                break;
+            first -= FAT_BUFFER_SECTORS;
+        }
+
+        for (count=0;count<FAT_BUFFERS;count++)
+        {
+            pbuf = fatfs_fat_lookup(fs, first + count * FAT_BUFFER_SECTORS);
+            if (!pbuf || !pbuf->dirty)
+                break;
+            run[count] = pbuf;
         }
 
-        last = pcur;
-        pcur = pcur->next;
+        // Move the run into consecutive slots so it goes out in one write
+        if (count > 1)
+        {
+            for (i=0;i<count;i++)
+            {
+                if (run[i]->sector == fs->fat_data[i])
+                    continue;
+
+                for (j=0;fs->fat_buffers[j].sector != fs->fat_data[i];j++)
+                    ;
+                fatfs_fat_swap_slots(run[i], &fs->fat_buffers[j]);
+            }
+        }
     }
+    else
+        run[0] = pcur;
+
+    sectors = count * FAT_BUFFER_SECTORS;
+
+    // Limit to sectors used for the FAT
+    if (first >= fs->fat_begin_lba && (first - fs->fat_begin_lba) + sectors > fs->fat_sectors)
+        sectors = fs->fat_sectors - (first - fs->fat_begin_lba);
+
+    if (fs->disk_io.write_media)
+    {
+        if (!fs->disk_io.write_media(first, run[0]->sector, sectors))
+            return 0;
+
+        fs->fat_stats.writes++;
+        fs->fat_stats.sectors += sectors;
+    }
+
+    for (i=0;i<count;i++)
+        run[i]->dirty = 0;
+
+    return 1;
+}
+//-----------------------------------------------------------------------------
+// fatfs_fat_read_sector: Read a FAT sector
+//-----------------------------------------------------------------------------
+static struct fat_cache_buf *fatfs_fat_read_sector(struct fatfs *fs, uint32 sector)
+{
+    struct fat_cache_buf *pcur;
+    uint32 address = sector;
+
+    // Buffers of the FAT itself start a whole number of buffers into it
+    if (sector >= fs->fat_begin_lba)
+        address -= (sector - fs->fat_begin_lba) % FAT_BUFFER_SECTORS;
 
     // We found the sector already in FAT buffer chain
+    pcur = fatfs_fat_lookup(fs, address);
     if (pcur)
+        fs->fat_stats.hits++;
+    else
     {
-        pcur->ptr = (uint8 *)(pcur->sector + ((sector - pcur->address) * FAT_SECTOR_SIZE));
-        return pcur;
-    }
+        fs->fat_stats.misses++;
 
-    // Else, we removed the last item from the list
-    pcur = last;
+        // Else, reuse the least recently used buffer
+        pcur = fs->fat_buffer_tail;
 
-    // Add to start of sector buffer list (now newest sector)
-    pcur->next = fs->fat_buffer_head;
-    fs->fat_buffer_head = pcur;
+        // Writeback sector if changed
+        if (pcur->dirty)
+            if (!fatfs_fat_writeback(fs, pcur))
+                return NULL;
 
-    // Writeback sector if changed
-    if (pcur->dirty)
-        if (!fatfs_fat_writeback(fs, pcur))
-            return 0;
+        // Address is now new sector
+        fatfs_fat_unhash(fs, pcur);
+        pcur->address = address;
 
-    // Address is now new sector
-    pcur->address = sector;
+        // Read next sector
+        if (!fs->disk_io.read_media(pcur->address, pcur->sector, FAT_BUFFER_SECTORS))
+        {
+            // Read failed, invalidate buffer address
+            pcur->address = FAT32_INVALID_CLUSTER;
+            return NULL;
+        }
+
+        pcur->hnext = fs->fat_hash[FAT_HASH(address)];
+        fs->fat_hash[FAT_HASH(address)] = pcur;
+    }
 
-    // Read next sector
-    if (!fs->disk_io.read_media(pcur->address, pcur->sector, FAT_BUFFER_SECTORS))
+    // Move to start of sector buffer list (now newest sector)
+    if (pcur != fs->fat_buffer_head)
     {
-        // Read failed, invalidate buffer address
-        pcur->address = FAT32_INVALID_CLUSTER;
-        return NULL;
+        fatfs_fat_unlink(fs, pcur);
+        pcur->prev = NULL;
+        pcur->next = fs->fat_buffer_head;
+        fs->fat_buffer_head->prev = pcur;
+        fs->fat_buffer_head = pcur;
     }
 
-    pcur->ptr = pcur->sector;
+    pcur->ptr = (uint8 *)(pcur->sector + ((sector - pcur->address) * FAT_SECTOR_SIZE));
     return pcur;
 }
 //-----------------------------------------------------------------------------
+// fatfs_fat_invalidate: Drop a buffer's contents, making it the next reused
+//-----------------------------------------------------------------------------
+static void fatfs_fat_invalidate(struct fatfs *fs, struct fat_cache_buf *pbuf)
+{
+    fatfs_fat_unhash(fs, pbuf);
+    pbuf->address = FAT32_INVALID_CLUSTER;
+    pbuf->dirty = 0;
+
+    if (pbuf != fs->fat_buffer_tail)
+    {
+        fatfs_fat_unlink(fs, pbuf);
+        pbuf->next = NULL;
+        pbuf->prev = fs->fat_buffer_tail;
+        fs->fat_buffer_tail->next = pbuf;
+        fs->fat_buffer_tail = pbuf;
+    }
+}
+//-----------------------------------------------------------------------------
 // fatfs_fat_purge: Purge 'dirty' FAT sectors to disk
 //-----------------------------------------------------------------------------
 int fatfs_fat_purge(struct fatfs *fs)
 {
-    struct fat_buffer *pcur = fs->fat_buffer_head;
+    int i;
+
+    // Writeback sectors if changed (neighbours go out in the same write)
+    for (i=0;i<FAT_BUFFERS;i++)
+        if (fs->fat_buffers[i].dirty)
+            if (!fatfs_fat_writeback(fs, &fs->fat_buffers[i]))
+                return 0;
+
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+//                          Free Cluster Bitmap
+//-----------------------------------------------------------------------------
+#if FAT_FREE_MAP_CLUSTERS
+
+//-----------------------------------------------------------------------------
+// fatfs_free_map_build: Scan the FAT once to build the free cluster bitmap.
+// Returns 0 if the volume has too many clusters for it (or on read error);
+// either way the map stays off until the volume is mounted again, rather
+// than rescanning the FAT on every allocation.
+//-----------------------------------------------------------------------------
+static int fatfs_free_map_build(struct fatfs *fs)
+{
+    uint32 clusters, cluster, entries, next;
+    struct fat_cache_buf *pbuf = NULL;
 
-    // Itterate through sector buffer list
-    while (pcur)
+    if (fs->free_map_clusters)
+        return 1;
+    if (fs->free_map_off)
+        return 0;
+
+    // Entries in the FAT, limited to the clusters that really exist
+    entries = (fs->fat_type == FAT_TYPE_16) ? 256 : 128;
+    clusters = fs->fat_sectors * entries;
+    if (fs->cluster_limit && fs->cluster_limit < clusters)
+        clusters = fs->cluster_limit;
+
+    if (clusters > FAT_FREE_MAP_CLUSTERS || clusters <= 2)
     {
-        // Writeback sector if changed
-        if (pcur->dirty)
-            if (!fatfs_fat_writeback(fs, pcur))
+        fs->free_map_off = 1;
+        return 0;
+    }
+
+    // Bits past the last cluster read as in use
+    memset(fs->free_map, 0xFF, sizeof(fs->free_map));
+    fs->free_map_count = 0;
+    fs->free_map_hint = 0;
+
+    // Clusters 0 and 1 are reserved
+    for (cluster = 2; cluster < clusters; cluster++)
+    {
+        if (!pbuf || (cluster % entries) == 0)
+        {
+            pbuf = fatfs_fat_read_sector(fs, fs->fat_begin_lba + (cluster / entries));
+            if (!pbuf)
+            {
+                fs->free_map_off = 1;
                 return 0;
+            }
+        }
 
-        pcur = pcur->next;
+        if (fs->fat_type == FAT_TYPE_16)
+            next = FAT16_GET_16BIT_WORD(pbuf, (uint16)((cluster % entries) * 2));
+        else
+            next = FAT32_GET_32BIT_WORD(pbuf, (uint16)((cluster % entries) * 4)) & 0x0FFFFFFF;
+
+        if (next == 0)
+        {
+            fs->free_map[cluster / 32] &= ~(1UL << (cluster % 32));
+            fs->free_map_count++;
+            if (!fs->free_map_hint)
+                fs->free_map_hint = cluster;
+        }
     }
 
+    if (!fs->free_map_hint)
+        fs->free_map_hint = clusters;
+
+    fs->free_map_clusters = clusters;
     return 1;
 }
+//-----------------------------------------------------------------------------
+// fatfs_free_map_update: Track a change to a cluster's FAT entry
+//-----------------------------------------------------------------------------
+#if FATFS_INC_WRITE_SUPPORT
+static void fatfs_free_map_update(struct fatfs *fs, uint32 cluster, int used)
+{
+    uint32 *word;
+    uint32 bit;
+
+    // Not built yet (or beyond the last cluster)
+    if (cluster >= fs->free_map_clusters)
+        return;
+
+    word = &fs->free_map[cluster / 32];
+    bit = 1UL << (cluster % 32);
+
+    if (used && !(*word & bit))
+    {
+        *word |= bit;
+        fs->free_map_count--;
+    }
+    else if (!used && (*word & bit))
+    {
+        *word &= ~bit;
+        fs->free_map_count++;
+        if (cluster < fs->free_map_hint)
+            fs->free_map_hint = cluster;
+    }
+}
+//-----------------------------------------------------------------------------
+// fatfs_free_map_scan: Return the first cluster from 'cluster' onwards which
+// is free (used = 0) or in use (used = 1), a word of the bitmap at a time.
+// Returns free_map_clusters if there is none.
+//-----------------------------------------------------------------------------
+static uint32 fatfs_free_map_scan(struct fatfs *fs, uint32 cluster, int used)
+{
+    uint32 i = cluster / 32;
+    uint32 bits;
+
+    if (cluster >= fs->free_map_clusters)
+        return fs->free_map_clusters;
+
+    // Bits set where the wanted kind of cluster is, ignoring those before 'cluster'
+    bits = (used ? fs->free_map[i] : ~fs->free_map[i]) & (0xFFFFFFFFUL << (cluster % 32));
+    while (!bits)
+    {
+        if (++i >= FREE_MAP_WORDS(fs))
+            return fs->free_map_clusters;
+
+        bits = used ? fs->free_map[i] : ~fs->free_map[i];
+    }
+
+    cluster = (i * 32) + __builtin_ctz(bits);
+    return (cluster < fs->free_map_clusters) ? cluster : fs->free_map_clusters;
+}
+//-----------------------------------------------------------------------------
+// fatfs_free_map_first: First free cluster at or after start_cluster
+//-----------------------------------------------------------------------------
+static uint32 fatfs_free_map_first(struct fatfs *fs, uint32 start_cluster)
+{
+    uint32 cluster;
+
+    // Nothing is free below the hint
+    if (start_cluster <= fs->free_map_hint)
+    {
+        cluster = fatfs_free_map_scan(fs, fs->free_map_hint, 0);
+        fs->free_map_hint = cluster;
+        return cluster;
+    }
+
+    return fatfs_free_map_scan(fs, start_cluster, 0);
+}
+#endif
+#endif
 
 //-----------------------------------------------------------------------------
 //                        General FAT Table Operations
@@ -206,7 +500,7 @@ uint32 fatfs_find_next_cluster(struct fatfs *fs, uint32 current_cluster)
 {
     uint32 fat_sector_offset, position;
     uint32 nextcluster;
-    struct fat_buffer *pbuf;
+    struct fat_cache_buf *pbuf;
 
     // Why is '..' labelled with cluster 0 when it should be 2 ??
     if (current_cluster == 0)
@@ -264,7 +558,7 @@ void fatfs_set_fs_info_next_free_cluster(struct fatfs *fs, uint32 newValue)
     else
     {
         // Load sector to change it
-        struct fat_buffer *pbuf = fatfs_fat_read_sector(fs, fs->lba_begin+fs->fs_info_sector);
+        struct fat_cache_buf *pbuf = fatfs_fat_read_sector(fs, fs->lba_begin+fs->fs_info_sector);
         if (!pbuf)
             return ;
 
@@ -274,11 +568,14 @@ void fatfs_set_fs_info_next_free_cluster(struct fatfs *fs, uint32 newValue)
 
         // Write back FSINFO sector to disk
         if (fs->disk_io.write_media)
+        {
             fs->disk_io.write_media(pbuf->address, pbuf->sector, 1);
+            fs->fat_stats.writes++;
+            fs->fat_stats.sectors++;
+        }
 
         // Invalidate cache entry
-        pbuf->address = FAT32_INVALID_CLUSTER;
-        pbuf->dirty = 0;
+        fatfs_fat_invalidate(fs, pbuf);
     }
 }
 //-----------------------------------------------------------------------------
@@ -290,7 +587,20 @@ int fatfs_find_blank_cluster(struct fatfs *fs, uint32 start_cluster, uint32 *fre
     uint32 fat_sector_offset, position;
     uint32 nextcluster;
     uint32 current_cluster = start_cluster;
-    struct fat_buffer *pbuf;
+    struct fat_cache_buf *pbuf;
+
+#if FAT_FREE_MAP_CLUSTERS
+    // Search the bitmap instead when there is one
+    if (fatfs_free_map_build(fs))
+    {
+        current_cluster = fatfs_free_map_first(fs, start_cluster);
+        if (current_cluster >= fs->free_map_clusters)
+            return 0;
+
+        *free_cluster = current_cluster;
+        return 1;
+    }
+#endif
 
     do
     {
@@ -300,7 +610,8 @@ int fatfs_find_blank_cluster(struct fatfs *fs, uint32 start_cluster, uint32 *fre
         else
             fat_sector_offset = current_cluster / 128;
 
-        if ( fat_sector_offset < fs->fat_sectors)
+        // Stop at the end of the FAT or of the volume, whichever is first
+        if ( fat_sector_offset < fs->fat_sectors && current_cluster < fs->cluster_limit)
         {
             // Read FAT sector into buffer
             pbuf = fatfs_fat_read_sector(fs, fs->fat_begin_lba+fat_sector_offset);
@@ -342,13 +653,61 @@ int fatfs_find_blank_cluster(struct fatfs *fs, uint32 start_cluster, uint32 *fre
 }
 #endif
 //-----------------------------------------------------------------------------
+// fatfs_find_blank_run: Find a free cluster to follow prev_cluster in a chain
+// which needs 'count' more clusters. This is the cluster straight after
+// prev_cluster if free, else the start of the first free run of 'count'
+// clusters, else the first free cluster (searching from start_cluster).
+//-----------------------------------------------------------------------------
+#if FATFS_INC_WRITE_SUPPORT
+int fatfs_find_blank_run(struct fatfs *fs, uint32 start_cluster, uint32 prev_cluster, uint32 count, uint32 *free_cluster)
+{
+#if FAT_FREE_MAP_CLUSTERS
+    uint32 first, cluster, end;
+
+    if (fatfs_free_map_build(fs))
+    {
+        // Carry on contiguously from the end of the chain
+        cluster = prev_cluster + 1;
+        if (prev_cluster < fs->free_map_clusters && cluster < fs->free_map_clusters &&
+            (fs->free_map[prev_cluster / 32] & (1UL << (prev_cluster % 32))) &&
+            !(fs->free_map[cluster / 32] & (1UL << (cluster % 32))))
+        {
+            *free_cluster = cluster;
+            return 1;
+        }
+
+        first = fatfs_free_map_first(fs, start_cluster);
+        if (first >= fs->free_map_clusters)
+            return 0;
+
+        // Otherwise the first gap big enough for the rest of the chain
+        for (cluster = first; cluster < fs->free_map_clusters; cluster = fatfs_free_map_scan(fs, end, 0))
+        {
+            end = fatfs_free_map_scan(fs, cluster, 1);
+            if (end - cluster >= count)
+            {
+                *free_cluster = cluster;
+                return 1;
+            }
+        }
+
+        // Or failing that, the first free cluster
+        *free_cluster = first;
+        return 1;
+    }
+#endif
+
+    return fatfs_find_blank_cluster(fs, start_cluster, free_cluster);
+}
+#endif
+//-----------------------------------------------------------------------------
 // fatfs_fat_set_cluster: Set a cluster link in the chain. NOTE: Immediate
 // write (slow).
 //-----------------------------------------------------------------------------
 #if FATFS_INC_WRITE_SUPPORT
 int fatfs_fat_set_cluster(struct fatfs *fs, uint32 cluster, uint32 next_cluster)
 {
-    struct fat_buffer *pbuf;
+    struct fat_cache_buf *pbuf;
     uint32 fat_sector_offset, position;
 
     // Find which sector of FAT table to read
@@ -379,6 +738,10 @@ int fatfs_fat_set_cluster(struct fatfs *fs, uint32 cluster, uint32 next_cluster)
         FAT32_SET_32BIT_WORD(pbuf, (uint16)position, next_cluster);
     }
 
+#if FAT_FREE_MAP_CLUSTERS
+    fatfs_free_map_update(fs, cluster, next_cluster != 0);
+#endif
+
     return 1;
 }
 #endif
@@ -446,7 +809,14 @@ uint32 fatfs_count_free_clusters(struct fatfs *fs)
 {
     uint32 i,j;
     uint32 count = 0;
-    struct fat_buffer *pbuf;
+    uint32 cluster = 0;
+    struct fat_cache_buf *pbuf;
+
+#if FAT_FREE_MAP_CLUSTERS
+    // Kept up to date once built
+    if (fatfs_free_map_build(fs))
+        return fs->free_map_count;
+#endif
 
     for (i = 0; i < fs->fat_sectors; i++)
     {
@@ -457,6 +827,10 @@ uint32 fatfs_count_free_clusters(struct fatfs *fs)
 
         for (j = 0; j < FAT_SECTOR_SIZE; )
         {
+            // Entries past the last cluster are not free space
+            if (cluster++ >= fs->cluster_limit)
+                break;
+
             if (fs->fat_type == FAT_TYPE_16)
             {
                 if (FAT16_GET_16BIT_WORD(pbuf, (uint16)j) == 0)
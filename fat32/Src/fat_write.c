@@ -36,6 +36,7 @@
 #include <fat_write.h>
 #include <fat_string.h>
 #include <fat_misc.h>
+#include <fat_dcache.h>
 
 #if FATFS_INC_WRITE_SUPPORT
 //-----------------------------------------------------------------------------
@@ -54,8 +55,9 @@ int fatfs_add_free_space(struct fatfs *fs, uint32 *startCluster, uint32 clusters
 
     for (i=0;i<clusters;i++)
     {
-        // Start looking for free clusters from the beginning
-        if (fatfs_find_blank_cluster(fs, fs->rootdir_first_cluster, &nextcluster))
+        // Start looking for free clusters from the beginning, keeping the
+        // rest of the chain contiguous where there is room
+        if (fatfs_find_blank_run(fs, fs->rootdir_first_cluster, start, clusters - i, &nextcluster))
         {
             // Point last to this
             fatfs_fat_set_cluster(fs, start, nextcluster);
@@ -284,6 +286,9 @@ int fatfs_add_file_entry(struct fatfs *fs, uint32 dirCluster, char *filename, ch
     if (!fs->disk_io.write_media)
         return 0;
 
+    // Nothing cached may refer to an older entry of this short name
+    fatfs_dcache_remove(fs, dirCluster, shortfilename);
+
 #if FATFS_INC_LFN_SUPPORT
     // How many LFN entries are required?
     // NOTE: We always request one LFN even if it would fit in a SFN!
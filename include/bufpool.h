@@ -0,0 +1,31 @@
+/* bufpool.h */
+
+#ifndef	NBPOOLS
+#define	NBPOOLS	8		/* Maximum number of buffer pools	*/
+#endif
+
+#ifndef	BP_MAXB
+#define	BP_MAXB	4096		/* Maximum buffer size in bytes		*/
+#endif
+
+#define	BP_MINB	8		/* Minimum buffer size in bytes		*/
+
+#ifndef	BP_MAXN
+#define	BP_MAXN	256		/* Maximum number of buffers in a pool	*/
+#endif
+
+/* Each buffer is preceded by BP_HDR bytes that hold the ID of its	*/
+/*   pool, so freebuf finds the pool from the buffer address alone	*/
+/*   and buffers keep the 8-byte alignment of the heap			*/
+
+#define	BP_HDR	8
+
+struct	bpentry	{		/* Description of a single buffer pool	*/
+	struct	bpentry *bpnext;/* Pointer to next free buffer		*/
+	sid32	bpsem;		/* Semaphore that counts buffers	*/
+				/*    currently available in the pool	*/
+	uint32	bpsize;		/* Size of buffers in this pool		*/
+	};
+
+extern	struct	bpentry buftab[];/* Buffer pool table			*/
+extern	bpid32	nbpools;	/* Current number of allocated pools	*/
@@ -49,4 +49,4 @@ extern	struct	dentry	devtab[]; /* one entry per device */
 /* Configuration and Size Constants */
 
 #define	NPROC	     12		/* number of user processes		*/
-#define	NSEM	     12		/* number of semaphores			*/
+#define	NSEM	     40		/* number of semaphores			*/
@@ -2,6 +2,7 @@
 #include "stdint.h"
 #include "stm32.h"
 #include "kernel.h"
+#include "irqprio.h"
 #define NVIC_STIR	(uint32 *) 0xE000EF00
 
 /* System control block */
@@ -31,8 +32,17 @@ extern void delay(uint32_t usec);
 extern void delay_us(uint32_t delay_us);
 /* in file intr.S */
 extern	intmask	disable(void);
+extern	intmask	disableusb(void);
 extern	void	enable(void);
 extern	void	restore(uint32);
 
-#define SYS_ENTRY()   asm volatile("cpsid i")
-#define SYS_EXIT()    asm volatile("cpsie i")
\ No newline at end of file
+/* in file interrupt.c */
+#if INTRTRACE
+extern	uint32	intrstart;	/* CYCCNT when masking began		*/
+extern	uint32	intrmax;	/* Longest masked time in cycles	*/
+extern	uint32	intrmaxpc;	/* Caller that ended that section	*/
+extern	void	intrcheck(uint32);
+#endif
+
+#define SYS_ENTRY()   __set_BASEPRI_MAX(IRQ_BASEPRI(IRQ_KERNEL))
+#define SYS_EXIT()    __set_BASEPRI(0)
\ No newline at end of file
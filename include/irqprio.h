@@ -0,0 +1,25 @@
+/* irqprio.h - NVIC priorities and the kernel interrupt ceiling */
+
+/* Lower numbers are more urgent.  disable() raises BASEPRI to the	*/
+/*   kernel ceiling, so a handler more urgent than IRQ_KERNEL keeps	*/
+/*   running inside kernel critical sections; such a handler must not	*/
+/*   call into the kernel except through wkpost()			*/
+
+#define	IRQ_PRIOBITS	4	/* Priority bits the STM32F4 implements	*/
+
+#define	IRQ_SYSTICK	1	/* SysTick cycle clock			*/
+#define	IRQ_USB		2	/* USB OTG FS				*/
+#define	IRQ_SVC		3	/* System calls (may be made while	*/
+				/*   BASEPRI is at the ceiling)		*/
+#define	IRQ_KERNEL	4	/* Ceiling for kernel critical sections	*/
+#define	IRQ_CLOCK	6	/* TIM2 clock tick and timing wheel	*/
+#define	IRQ_PENDSV	15	/* Context switch, after everything	*/
+
+#define	IRQ_BASEPRI(p)	((p) << (8 - IRQ_PRIOBITS)) /* BASEPRI value	*/
+
+/* Build with INTRTRACE=1 to record the longest time kernel critical	*/
+/*   sections hold BASEPRI at the ceiling				*/
+
+#ifndef	INTRTRACE
+#define	INTRTRACE	0
+#endif
@@ -1,8 +1,8 @@
-/* memory.h - roundmb, truncmb, freestk */
+/* memory.h - roundmb, truncmb, freestk, mblksize, mblknext */
 #include <kernel.h>
 #define MAXADDR		0x2001f400		/* 64kB SRAM */
 #define HANDLERSTACK	1024			/* Size reserved for stack in Handler mode */
-#define	PAGE_SIZE	1024 // TODO: unused?
+#define	PAGE_SIZE	1024			/* Size of a malloc slab page	*/
 
 /*----------------------------------------------------------------------
  * roundmb, truncmb - Round or truncate address to memory block size
@@ -20,13 +20,126 @@
 				+ (uint32)sizeof(uint32)),	\
 				(uint32)roundmb(len) )
 
-struct	memblk	{			/* See roundmb & truncmb	*/
-	struct	memblk	*mnext;		/* Ptr to next free memory blk	*/
+struct	memblk	{			/* Header of a large malloc blk	*/
+	struct	memblk	*mnext;		/* Next block of the same owner	*/
+	struct	memblk	*mprev;		/* Previous block of that owner	*/
 	uint32	mlength;		/* Size of blk (includes memblk)*/
+	pid32	mowner;			/* Process that allocated it	*/
 	};
-extern	struct	memblk	memlist;	/* Head of free memory list	*/
+
+/*----------------------------------------------------------------------
+ * The heap is managed as a Two-Level Segregated Fit (TLSF) allocator.
+ * Every block starts with a memhdr that records its size and the block
+ * physically before it, so getmem and freemem split and coalesce in
+ * constant time.  Free blocks are kept in segregated lists: the first
+ * level picks a power of two, the second divides it into MSLCOUNT
+ * equal ranges, and a bitmap per level finds a nonempty list with one
+ * count-leading-zero instruction.
+ *----------------------------------------------------------------------
+ */
+struct	memhdr	{
+	uint32	msize;			/* Block size incl. header and	*/
+					/*   the MFREE/MPFREE flags	*/
+	struct	memhdr	*mphys;		/* Block physically before this	*/
+	struct	memhdr	*mnextfree;	/* Next block on the free list	*/
+	struct	memhdr	*mprevfree;	/* Previous block on the list	*/
+					/*   (both valid only if free)	*/
+	};
+
+#define	MFREE		0x1		/* Block is on a free list	*/
+#define	MPFREE		0x2		/* Block before this one is free*/
+#define	MFLAGS		(MFREE | MPFREE)
+#define	MHDRSIZE	8		/* Header bytes of a used block	*/
+#define	MMINBLK		sizeof(struct memhdr) /* Smallest block	*/
+
+#define	MSLBITS		4		/* log2 of second level lists	*/
+#define	MSLCOUNT	(1U << MSLBITS)	/* Lists per first level	*/
+#define	MFLSHIFT	(MSLBITS + 3)	/* Sizes below 1<<MFLSHIFT use	*/
+					/*   first level 0, 8 bytes apart*/
+#define	MFLMAX		18		/* Heap must be below 1<<MFLMAX	*/
+#define	MFLCOUNT	(MFLMAX - MFLSHIFT + 1)
+
+#define	mblksize(h)	((h)->msize & ~MFLAGS)
+#define	mblknext(h)	((struct memhdr *)((char *)(h) + mblksize(h)))
+
+/*----------------------------------------------------------------------
+ * malloc serves requests up to SLABMAX bytes from slabs: PAGE_SIZE
+ * pages aligned on PAGE_SIZE and cut into equal objects of one size
+ * class.  Objects carry no header; free finds the page by masking the
+ * address and checks slabmap to tell it from a larger block.  Each
+ * page keeps one owner byte per object so that kill can reclaim the
+ * objects of a process; larger blocks are linked on a list per process.
+ *----------------------------------------------------------------------
+ */
+#define	NSLAB		10		/* Number of size classes	*/
+#define	SLABMAX		256		/* Largest size a slab serves	*/
+#define	SLABNOOWNER	0xFF		/* Owner byte of a free object	*/
+
+struct	slabpage {			/* Header at the start of a page*/
+	struct	slabpage *snext;	/* Next page with a free object	*/
+	struct	slabpage *sprev;	/* Previous page on that list	*/
+	void	*sfree;			/* First free object in the page*/
+	uint16	sclass;			/* Size class of the page	*/
+	uint16	sinuse;			/* Objects allocated from it	*/
+	};
+
+struct	slabclass {			/* One entry per size class	*/
+	uint32	ssize;			/* Object size of the class	*/
+	uint32	snobj;			/* Objects that fit in a page	*/
+	struct	slabpage *spages;	/* Pages with a free object	*/
+	uint32	snpages;		/* Pages the class holds	*/
+	uint32	sinuse;			/* Objects allocated now	*/
+	uint32	sallocs;		/* Allocations since boot	*/
+	uint32	sfrees;			/* Frees since boot		*/
+	};
+
+extern	struct	slabclass slabtab[];
+
+/*----------------------------------------------------------------------
+ * heapstat fills in a memstat.  Histogram bin i counts free blocks on
+ * first level i of the TLSF lists: bin 0 holds blocks below
+ * 1 << MFLSHIFT bytes and bin i > 0 blocks from 1 << (MFLSHIFT+i-1)
+ * up to twice that.  Rates come from comparing two snapshots.
+ *----------------------------------------------------------------------
+ */
+struct	memstat	{
+	uint32	mtotal;			/* Free bytes right after boot	*/
+	uint32	mfree;			/* Bytes in free blocks now	*/
+	uint32	mpeak;			/* Most bytes ever in use	*/
+	uint32	mlargest;		/* Largest getmem that fits now	*/
+	uint32	mnfree;			/* Number of free blocks	*/
+	uint32	mfrag;			/* Fragmentation in 1/1000ths	*/
+	uint32	mgets;			/* getmem calls that succeeded	*/
+	uint32	mputs;			/* freemem calls that succeeded	*/
+	uint32	mtime;			/* Clock tick (ms) of snapshot	*/
+	uint32	mhist[MFLCOUNT];	/* Free blocks per size range	*/
+	};
+
+/*----------------------------------------------------------------------
+ * Build with MEMTRACE=1 to have malloc count calls and bytes for each
+ * return address, so memstat can show which call sites use the heap.
+ *----------------------------------------------------------------------
+ */
+#ifndef	MEMTRACE
+#define	MEMTRACE	0
+#endif
+
+#define	NMEMSITE	16		/* Call sites malloc tracks	*/
+
+struct	memsite	{
+	void	*mspc;			/* Return address of the caller	*/
+	uint32	mscalls;		/* Calls made from there	*/
+	uint32	msbytes;		/* Bytes those calls asked for	*/
+	};
+
+#if MEMTRACE
+extern	struct	memsite	memsites[];
+extern	uint32	memsitemiss;		/* Calls from untracked sites	*/
+#endif
+
 extern	void	*minheap;		/* Start of heap		*/
 extern	void	*maxheap;		/* Highest valid heap address	*/
+extern	uint32	memfree;		/* Bytes in free heap blocks	*/
 
 
 /* Added by linker */
@@ -0,0 +1,33 @@
+/* mutex.h - isbadmutex */
+
+/* A mutex has an owner, so a process that blocks on it can lend its	*/
+/*   priority to the owner (priority inheritance).  A mutex created	*/
+/*   with a ceiling also raises its owner to the ceiling as soon as it	*/
+/*   is locked (immediate priority ceiling).  prprio holds a process's	*/
+/*   effective priority and prbprio the priority it was given by	*/
+/*   create or chprio.							*/
+
+#ifndef	NMUTEX
+#define	NMUTEX		16	/* Number of mutexes, if not defined	*/
+#endif
+
+/* Mutex state definitions */
+
+#define	MX_FREE		0	/* Mutex table entry is available	*/
+#define	MX_USED		1	/* Mutex table entry is in use		*/
+
+#define	MX_NONE		(-1)	/* No owner, or end of a held list	*/
+
+/* Mutex table entry */
+
+struct	mxentry	{
+	byte	mxstate;	/* Whether entry is MX_FREE or MX_USED	*/
+	pid32	mxowner;	/* Process holding it or MX_NONE	*/
+	pri16	mxceil;		/* Ceiling priority (0 means none)	*/
+	int32	mxnext;		/* Next mutex held by the same owner	*/
+	qid16	mxqueue;	/* Waiting processes by priority	*/
+};
+
+extern	struct	mxentry mxtab[];
+
+#define	isbadmutex(m)	((int32)(m) < 0 || (m) >= NMUTEX)
@@ -12,8 +12,12 @@
 
 
 
+/* Saved context of a process that has not run yet, as create leaves	*/
+/*   it at prstkptr; same layout as cmcm_stack_frame_t with a basic	*/
+/*   hardware frame							*/
 typedef struct {
   uint32 r4, r5, r6, r7, r8, r9, r10, r11;
+  uint32 exc_return;
   uint32 r0, r1, r2, r3, r12, lr, pc, psr;
 } context_t;
 
@@ -28,6 +32,7 @@ typedef struct {
     uint32 r9;
     uint32 r10;
     uint32 r11;
+    uint32 exc_return;  // bit 4 clear: s16-s31 follow, extended hw frame
   } sw_frame;
 
   // these registers are pushed by the hardware
@@ -53,6 +58,7 @@ typedef struct {
 #define	PR_SUSP		5	/* Process is suspended			*/
 #define	PR_WAIT		6	/* Process is on semaphore queue	*/
 #define	PR_RECTIM	7	/* Process is receiving with timeout	*/
+#define	PR_MUTEX	8	/* Process is on a mutex queue		*/
 
 /* Miscellaneous process definitions */
 
@@ -64,6 +70,8 @@ typedef struct {
 #define	INITSTK		4096/2	/* Initial process stack size		*/
 #define	INITPRIO	20	/* Initial process priority		*/
 #define	INITRET		userret	/* Address to which process returns	*/
+#define	INITEXCRET	0xFFFFFFFD /* EXC_RETURN: thread mode, PSP,	*/
+				/*   basic frame (no FPU context)	*/
 
 /* Inline code to check process ID (assumes interrupts are disabled)	*/
 
@@ -79,12 +87,12 @@ typedef struct {
 
 struct procent {		/* Entry in the process table		*/
 	uint16	prstate;	/* Process state: PR_CURR, etc.		*/
-	pri16	prprio;		/* Process priority			*/
+	pri16	prprio;		/* Process priority (effective)		*/
 	uint32	*prstkptr;	/* Saved stack pointer			*/
 	uint32	*prstkbase;	/* Base of run time stack		*/
 	uint32	prstklen;	/* Stack length in bytes		*/
 	char	prname[PNMLEN];	/* Process name				*/
-	sid32	prsem;		/* Semaphore on which process waits	*/
+	sid32	prsem;		/* Semaphore or mutex process waits on	*/
 	pid32	prparent;	/* ID of the creating process		*/
 	umsg32	prmsg;		/* Message sent to this process		*/
 	bool8	prhasmsg;	/* Nonzero iff msg is valid		*/
@@ -93,6 +101,14 @@ struct procent {		/* Entry in the process table		*/
   void *img;
   //char parg[5][16];//
   void *parg[MAX_ARG]; 
+	uint64	prcycles;	/* CPU cycles charged to the process	*/
+	uint64	prbirth;	/* cpucycles when the process was made	*/
+	uint32	prctxsw;	/* Times the process was switched in	*/
+	uint32	prstamp;	/* DWT->CYCCNT when last charged	*/
+	pri16	prbprio;	/* Priority without inheritance		*/
+	int32	prmxheld;	/* First mutex held or MX_NONE		*/
+	struct	memblk *prmlist;/* Large malloc blocks the process owns	*/
+	uint32	prheap;		/* Bytes of malloc memory it owns	*/
 };
 
 /* Marker for the top of a process stack (used to help detect overflow)	*/
@@ -101,4 +117,5 @@ struct procent {		/* Entry in the process table		*/
 extern	struct	procent proctab[];
 extern	int32	prcount;	/* Currently active processes		*/
 extern	pid32	currpid;	/* Currently executing process		*/
+extern	uint64	cpucycles;	/* Cycles charged to all processes	*/
 extern bool start_null;
\ No newline at end of file
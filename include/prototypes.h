@@ -13,6 +13,14 @@ extern	status	addargs(pid32, int32, int32[], int32,char *, void *);
 
  
 
+/* in file bytestr.c */
+extern	void	*bytecpy(void *, const void *, int32);
+extern	void	byteset(void *, uint8, uint32);
+extern	void	bytemove(void *, const void *, uint32);
+extern	int32	bytecmp(const void *, const void *, int32);
+extern	void	*bytechr(const void *, int32, uint32);
+extern	int32	bytelen(const char *);
+
 /* in file chprio.c */
 extern	pri16	chprio(pid32, pri16);
 
@@ -21,6 +29,7 @@ extern	pri16	chprio(pid32, pri16);
 /* in file clkhandler.c */
 //extern	interrupt clkhandler(void);
 extern interrupt TIM2_Handler();
+extern	void	clkidle(void);
 
 /* in file clkinit.c */
 extern	void	clkinit(void);
@@ -36,6 +45,7 @@ extern	syscall	control(did32, int32, int32, int32);
 
 /* in file create.c */
 extern	pid32	create(void *, uint32, pri16, char *, uint32, ...);
+extern	void	cpucharge(void);
 
 /* in file ctxsw.S */
 extern	void	ctxsw(void *, void *);
@@ -43,13 +53,14 @@ extern	void	ctxsw(void *, void *);
  
  
 /* in file freebuf.c */
-//extern	syscall	freebuf(char *);
+extern	syscall	freebuf(char *);
 
 /* in file freemem.c */
 extern	syscall	freemem(char *, uint32);
 
 /* in file getbuf.c */
-//extern	char	*getbuf(bpid32);
+extern	char	*getbuf(bpid32);
+extern	char	*nbgetbuf(bpid32);
 
 /* in file getc.c */
 extern	syscall	getc(did32);
@@ -61,6 +72,9 @@ extern	pid32	getitem(pid32);
 
 /* in file getmem.c */
 extern	char	*getmem(uint32);
+extern	char	*getalign(uint32, uint32);
+extern	syscall	resizemem(char *, uint32, uint32);
+extern	syscall	heapstat(struct memstat *);
 
 /* in file getpid.c */
 extern	pid32	getpid(void);
@@ -131,13 +145,26 @@ extern	int32	lexan(char *, int32, char *, int32 *, int32 [], int32 []);
  
 
  
+/* in file malloc.c */
+extern	void	heapreclaim(pid32);
+extern	syscall	heapgive(void *, pid32);
+
 /* in file mkbufpool.c */
-//extern	bpid32	mkbufpool(int32, int32);
+extern	bpid32	mkbufpool(int32, int32);
+extern	status	bufinit(void);
 
 /* in file mount.c */
 extern	syscall	mount(char *, char *, did32);
 extern	int32	namlen(char *, int32);
 
+/* in file mutex.c */
+extern	int32	mxcreate(pri16);
+extern	syscall	mxdelete(int32);
+extern	syscall	mxlock(int32);
+extern	syscall	mxunlock(int32);
+extern	void	mxupdate(pid32);
+extern	void	mxrelease(pid32);
+
 /* in file naminit.c */
 extern	status	naminit(void);
 
@@ -151,6 +178,7 @@ extern	devcall	namopen(struct dentry *, char *, char *);
 
 /* in file newqueue.c */
 extern	qid16	newqueue(void);
+extern	qid16	newreadyq(void);
 
 /* in file open.c */
 extern	syscall	open(did32, char *, char *);
@@ -168,6 +196,15 @@ extern	void	panic(char *);
 /* in file platinit.c */
 extern	void	platinit(void);
 
+/* in file ports.c */
+extern	syscall	ptinit(int32);
+extern	syscall	ptcreate(int32);
+extern	syscall	ptsend(int32, umsg32);
+extern	uint32	ptrecv(int32);
+extern	int32	ptcount(int32);
+extern	syscall	ptdelete(int32, int32 (*)(int32));
+extern	syscall	ptreset(int32, int32 (*)(int32));
+
 
 /* in file putc.c */
 extern	syscall	putc(did32, char);
@@ -237,6 +274,9 @@ extern	syscall	sleep(int32);
  
  
 
+/* in file stdbuf.c */
+extern	void	bufdone(pid32);
+
 /* in file suspend.c */
 extern	syscall	suspend(pid32);
 
@@ -251,8 +291,21 @@ extern	void	userret(void);
 /* in file wait.c */
 extern	syscall	wait(sid32);
 
-/* in file wakeup.c */
-extern	void	wakeup(void);
+/* in file tmwheel.c */
+extern	void	tminit(void);
+extern	void	tminsert(struct tmnode *, uint32);
+extern	void	tmremove(struct tmnode *);
+extern	void	tmadvance(uint32);
+extern	uint32	tmnext(void);
+extern	int32	tmset(uint32, void (*)(int32), int32);
+extern	int32	tmrepeat(uint32, void (*)(int32), int32);
+extern	syscall	tmcancel(int32);
+
+/* in file workq.c */
+extern	void	wkinit(void);
+extern	status	wkpost(void (*)(int32), int32);
+extern	void	wkwake(void);
+extern	process	wkworker(void);
 
 /* in file write.c */
 extern	syscall	write(did32, char *, uint32);
@@ -285,6 +338,7 @@ extern	void	ttyhandle_out(struct ttycblk *);
 
 /* in file ttyhandler.c */
 extern	void	ttyhandler(uint32, char c, int tipo);
+extern	void	ttyrxwork(int32);
 
 /* in file ttyinit.c */
 // extern	devcall	ttyinit(struct dentry *);
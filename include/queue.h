@@ -2,10 +2,18 @@
 
 /* Queue structure declarations, constants, and inline functions	*/
 
-/* Default # of queue entries: 1 per process plus 2 for ready list plus	*/
-/*			2 for sleep list plus 2 per semaphore		*/
+/* Number of ready list priority levels; create, chprio and mxcreate	*/
+/*   reject priorities of NRPRIO or more (must be a multiple of 32, at	*/
+/*   most 1024)								*/
+#ifndef NRPRIO
+#define	NRPRIO	64
+#endif
+
+/* Default # of queue entries: 1 per process plus 2 per ready list	*/
+/*	priority level plus 2 for sleep list plus 2 per semaphore	*/
+/*	plus 2 per mutex						*/
 #ifndef NQENT
-#define NQENT	(NPROC + 4 + NSEM + NSEM)
+#define NQENT	(NPROC + NRPRIO + NRPRIO + 2 + NSEM + NSEM + NMUTEX + NMUTEX)
 #endif
 
 #define	EMPTY	(-1)		/* Null value for qnext or qprev index	*/
@@ -20,11 +28,44 @@ struct	qentry	{		/* One per process plus two per list	*/
 
 extern	struct qentry	queuetab[];
 
+/* The ready list is NRPRIO FIFO queues, one per priority level, that	*/
+/*   occupy consecutive queue table slots starting at readylist.  A	*/
+/*   bit is set in rdymap for every nonempty level and in rdysum for	*/
+/*   every nonempty word of rdymap, so the highest ready priority is	*/
+/*   found with two count-leading-zero instructions.			*/
+
+#define	NRWORDS		(NRPRIO / 32)
+
+extern	uint32	rdysum;			/* Nonempty words of rdymap	*/
+extern	uint32	rdymap[];		/* Nonempty priority levels	*/
+
+#define	rdylevel(k)	((k) <= 0 ? 0 : ((k) >= NRPRIO ? NRPRIO - 1 : (k)))
+#define	rdyqueue(l)	(readylist + 2 * (l))
+#define	isrdyhead(q)	((q) >= readylist && (q) < readylist + 2 * NRPRIO \
+			 && (((q) - readylist) & 1) == 0)
+
+/*------------------------------------------------------------------------
+ *  rdytop  -  Return the ready queue of the highest nonempty priority
+ *		 level (the level 0 queue when no process is ready)
+ *------------------------------------------------------------------------
+ */
+static __inline__ qid16 rdytop(void)
+{
+	uint32	w;			/* Index of top nonempty word	*/
+
+	if (rdysum == 0) {
+		return readylist;
+	}
+	w = 31 - __builtin_clz(rdysum);
+	return rdyqueue(32 * w + 31 - __builtin_clz(rdymap[w]));
+}
+
 /* Inline queue manipulation functions */
 
 #define	queuehead(q)	(q)
 #define	queuetail(q)	((q) + 1)
-#define	firstid(q)	(queuetab[queuehead(q)].qnext)
+#define	firstid(q)	(queuetab[queuehead((q) == readylist ?		\
+				rdytop() : (q))].qnext)
 #define	lastid(q)	(queuetab[queuetail(q)].qprev)
 #define	isempty(q)	(firstid(q) >= NPROC)
 #define	nonempty(q)	(firstid(q) <  NPROC)
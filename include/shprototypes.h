@@ -10,6 +10,9 @@ extern shellcmd xsh_dump(int nargs, char *args[]);
 //extern	shellcmd  xsh_cat	(int32, char *[]);
 
 extern	shellcmd  xsh_blink	(int32, char *[]);
+
+/* in file xsh_bench.c */
+extern	shellcmd  xsh_bench	(int32, char *[]);
 /* in file xsh_clear.c */
 extern	shellcmd  xsh_clear	(int32, char *[]);
 
@@ -72,6 +75,7 @@ extern	shellcmd  xsh_ls	(int32, char *[]);
 extern	shellcmd  xsh_cd	(int32, char *[]);
 extern	shellcmd  xsh_pwd	(int32, char *[]);
 extern	shellcmd  xsh_mkdir	(int32, char *[]);
+extern	shellcmd  xsh_df	(int32, char *[]);
 extern	shellcmd  xsh_touch	(int32, char *[]);
 extern	shellcmd  xsh_rmdir	(int32, char *[]);
 extern	shellcmd  xsh_rm	(int32, char *[]);
@@ -16,6 +16,14 @@
 #define	stdout	((proctab[currpid]).prdesc[1])
 #define	stderr	((proctab[currpid]).prdesc[2])
 
+/* Buffering modes for setvbuf; a process's stdout is line buffered	*/
+/*   on a tty and fully buffered otherwise				*/
+
+#define	_IOFBF		1	/* Write when the buffer is full	*/
+#define	_IOLBF		2	/* Write at each newline too		*/
+#define	_IONBF		3	/* Write each character at once		*/
+#define	BUFSIZ		128	/* Size of a default stdout buffer	*/
+
 
 /* Prototypes for formatted output functions */
 
@@ -38,6 +46,12 @@ extern	char	*fgets(char *, int, int);
 extern	int	fputc(int, int);
 extern	int	fputs(char *, int);
 extern	int	putchar(int);
+
+/* Buffering of stdout (in file stdbuf.c) */
+
+extern	int	bufputc(int, int);
+extern	int	fflush(int);
+extern	int	setvbuf(int, char *, int, int);
 extern	int	getchar(void);
 
 extern void    hexdump(
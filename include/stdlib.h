@@ -13,7 +13,12 @@ long labs(long);
 int atoi(char *);
 long atol(char *);
 void bzero(void *, int);
-void qsort(char *, unsigned int, int, int (*)(void));
+void qsort(void *, size_t, size_t, int (*)(const void *, const void *));
+void qsort_r(void *, size_t, size_t,
+             int (*)(const void *, const void *, void *), void *);
+void msort(void *, size_t, size_t, int (*)(const void *, const void *));
+void msort_r(void *, size_t, size_t,
+             int (*)(const void *, const void *, void *), void *);
 int rand(void);
 void srand(unsigned int);
 
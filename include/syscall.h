@@ -72,6 +72,7 @@ XINU_GET_PATH,
 XINU_CD,
 XINU_JSON,
 XINU_GET_LEN,
+XINU_HEAP_STAT,
 
 
 };
@@ -134,6 +135,7 @@ typedef struct syscall_s
     void *(*js0n)(void *);////const char *(*js0n)(const char *key, size_t klen,const char *json, size_t jlen, size_t *vlen);
     uint32 (*len)();
     char *(*fifo)();
+    int (*heapStat)(void *);    /* fills a struct memstat */
 }syscall_t;
 extern syscall_t *sys;
 extern syscall_t syscallp;
@@ -211,4 +213,5 @@ extern void *SVC_XINU_GET_PATH(uint32 *);
 extern void *SVC_XINU_CD(uint32 *);
 extern void *SVC_XINU_JSON(uint32 *);
 extern void *SVC_XINU_GET_LEN(uint32 *);
+extern void *SVC_XINU_HEAP_STAT(uint32 *);
 
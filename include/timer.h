@@ -4,7 +4,56 @@ General purpose timer */
 extern	uint32	clktime;	/* current time in secs since boot	*/
 extern  uint32  count1000;      /* ms since last clock tick             */
 
-extern	qid16	sleepq;		/* queue for sleeping processes		*/
-extern	int32	slnonempty;	/* nonzero if sleepq is nonempty	*/
-extern	int32	*sltop;		/* ptr to key in first item on sleepq	*/
+extern	qid16	sleepq;		/* kept so insertd(pid, sleepq, delay)	*/
+				/*   still works; see tmwheel.c		*/
 extern	uint32	preempt;	/* preemption counter			*/
+
+/* Tickless idle: while only the null process can run, TIM2 is	*/
+/*   reprogrammed to interrupt at the next timing wheel deadline	*/
+/*   (tmnext) instead of every tick, and the elapsed ticks are charged	*/
+/*   in one step							*/
+
+#ifndef	TICKLESS
+#define	TICKLESS	1	/* Nonzero to skip ticks while idle	*/
+#endif
+
+#define	CLKTICK		0x1001	/* TIM2 counts per clock tick (ARR+1)	*/
+#define	CLKMAXIDLE	1000	/* Most ticks one idle period may span	*/
+#define	CLKMARGIN	16	/* TIM2 counts needed to reprogram ARR	*/
+
+extern	uint32	clkskip;	/* ticks covered by the next interrupt	*/
+extern	uint32	clkskipped;	/* ticks that raised no interrupt	*/
+extern	uint32	clkwakeups;	/* times the null process left WFI	*/
+
+
+/* Hierarchical timing wheel that holds sleeping processes.  Level L	*/
+/*   has TMSLOTS slots that are each TMSLOTS^L ticks wide, so insert	*/
+/*   and cancel are constant time and each tick visits one slot	*/
+
+#define	TMBITS		5		/* log2 of slots per level; the	*/
+					/*   slots fill a 32-bit map	*/
+#define	TMSLOTS		(1U << TMBITS)	/* Slots per level		*/
+#define	TMMASK		(TMSLOTS - 1)
+#define	TMLEVELS	4		/* Levels in the wheel		*/
+#define	TMNONE		0xFFFFFFFF	/* tmnext() value when empty	*/
+
+struct	tmnode	{			/* Entry in a wheel slot	*/
+	struct	tmnode	*tnext;		/* Next node in the same slot	*/
+	struct	tmnode	**tpprev;	/* Link pointing to this node	*/
+	uint32	tdeadline;		/* Value of tmnow at expiry	*/
+	pid32	tpid;			/* Process to make ready, or	*/
+					/*   callout ID if tfunc is set	*/
+	void	(*tfunc)(int32);	/* Callout function or NULL	*/
+	int32	targ;			/* Argument passed to tfunc	*/
+	uint32	tperiod;		/* Ticks between repeats, or 0	*/
+};
+
+extern	uint32	tmnow;		/* ticks the wheel has advanced		*/
+extern	struct	tmnode	slptab[];/* one wheel node per process		*/
+
+/* Callouts run a function instead of waking a process; the wheel	*/
+/*   posts it to the work queue, so it runs in the worker process	*/
+
+#define	NCALLOUT	32	/* Callouts that may be pending at once	*/
+
+#define	tmpending(t)	((t)->tpprev != NULL)
@@ -0,0 +1,28 @@
+/* workq.h - wkfull */
+
+/* Deferred interrupt work: an interrupt handler posts a function and	*/
+/*   argument to a lock-free ring, and a high-priority worker process	*/
+/*   runs the posted items in batches with interrupts enabled		*/
+
+#define	WKSLOTS		32		/* Slots in the ring (power of 2)*/
+#define	WKMASK		(WKSLOTS - 1)
+#define	WKPRIO		(NRPRIO - 1)	/* Priority of the worker	*/
+#define	WKSTK		1024		/* Stack size of the worker	*/
+
+struct	wkentry	{			/* Slot in the work ring	*/
+	void	(*wkfunc)(int32);	/* Function to run		*/
+	int32	wkarg;			/* Argument to pass it		*/
+	volatile uint32	wkseq;		/* Ring position when the slot	*/
+					/*   is free, position+1 when	*/
+					/*   it holds an item		*/
+};
+
+extern	struct	wkentry	wktab[];	/* The work ring		*/
+extern	volatile uint32	wkhead;		/* Next position to post	*/
+extern	uint32	wktail;			/* Next position to run		*/
+extern	uint32	wkdropped;		/* Items lost to a full ring	*/
+
+/* The item at the tail has not been posted yet */
+
+#define	wkempty()	(__atomic_load_n(&wktab[wktail & WKMASK].wkseq, \
+			    __ATOMIC_ACQUIRE) != wktail + 1)
@@ -7,6 +7,10 @@
 #include <queue.h>
 #include <resched.h>
 #include <semaphore.h>
+#include <mutex.h>
+#include <ports.h>
+#include <bufpool.h>
+#include <workq.h>
 #include <memory.h>
 #include <timer.h>	/* STM32 Timer peripheral */
 #include <uart.h>	/* STM32 UART peripheral */
@@ -1,17 +1,17 @@
-/* dprnt.c - _doprnt, _prtl2, _prtl8, _prtl10, _prtX16, _prtl16 */
+/* dprnt.c - _doprnt, _prtl2, _prtl8 */
 
 #include <stdarg.h>
 
 #define	MAXSTR	80
 #define NULL    0
-#define PRECISION 6
 
-  void _prtl10(long num, char *str);
   void _prtl8(long num, char *str);
-  void _prtX16(long num, char *str);
-  void _prtl16(long num, char *str);
   void _prtl2(long num, char *str);
-//  void _prtdbl(double num, int precision, char *str);
+extern int _fmtu10(unsigned long num, char *str);
+extern int _fmthex(unsigned long num, char *str, int upper, int mindig);
+extern int _fmtflt(float num, int prec, char *str);
+
+#define FLTPREC     16      /* most %f digits _fmtflt prints   */
 
 /*------------------------------------------------------------------------
  *  _doprnt  -  Format and write output using 'func' to write characters.
@@ -29,7 +29,7 @@ void	_doprnt(
     int i;
     int f;                      /* The format character (comes after %) */
     char *str;                  /* Running pointer in string            */
-    char string[20];            /* The string str points to this output */
+    char string[64];            /* The string str points to this output */
 
     /*  from number conversion              */
     int length;                 /* Length of string "str"               */
@@ -38,9 +38,9 @@ void	_doprnt(
     int fmax, fmin;             /* Field specifications % MIN . MAX s   */
     int leading;                /* No. of leading/trailing fill chars   */
     char sign;                  /* Set to '-' for negative decimals     */
-    char digit1;                /* Offset to add to first numeric digit */
+    int prec;                   /* Digits after the point for %f, or -1 */
     long larg;
-    //double darg;
+    double darg;
 
     for (;;)
     {
@@ -82,8 +82,9 @@ void	_doprnt(
                 fmin = fmin * 10 + *fmt++ - '0';
             }
         }
-        /* Allow for maximum string width for %s */
+        /* Allow for maximum string width for %s, precision for %f */
         fmax = 0;
+        prec = -1;
         if (*fmt == '.')
         {
             if (*(++fmt) == '*')
@@ -98,6 +99,7 @@ void	_doprnt(
                     fmax = fmax * 10 + *fmt++ - '0';
                 }
             }
+            prec = fmax;
         }
 
         str = string;
@@ -134,34 +136,31 @@ void	_doprnt(
             {
                 sign = '-';
             }
-            _prtl10(larg, str);
+            _fmtu10((larg < 0) ? -(unsigned long) larg : larg, str);
             break;
             
         case 'f':
-           // darg = va_arg(ap, double);
+            darg = va_arg(ap, double);
 
-           // if (darg < 0)
-           // {
-           //     sign = '-';
-           // }
-           // _prtdbl(darg, PRECISION, str);
+            if (darg < 0)
+            {
+                sign = '-';
+                darg = -darg;
+            }
+            /* The digits must fit in string[] after up to 39 integer */
+            /*   digits, so a larger precision prints 16 decimals    */
+            if (prec > FLTPREC)
+            {
+                prec = FLTPREC;
+            }
+            _fmtflt((float) darg, prec, str);
+            fmax = 0;
             break;
 
         case 'u':
-            digit1 = '\0';
-            /* "negative" longs in unsigned format  */
-            /* can't be computed with long division */
-            /* convert *args to "positive", digit1  */
-            /* = how much to add back afterwards    */
             larg = va_arg(ap, long);
 
-            while (larg < 0)
-            {
-                larg -= 1000000000L;
-                ++digit1;
-            }
-            _prtl10(larg, str);
-            str[0] += digit1;
+            _fmtu10(larg, str);
             fmax = 0;
             break;
 
@@ -175,25 +174,25 @@ void	_doprnt(
         case 'X':
             larg = va_arg(ap, long);
 
-            _prtX16(larg, str);
+            _fmthex(larg, str, 1, 0);
             fmax = 0;
             break;
 
         case 'x':
             larg = va_arg(ap, long);
 
-            _prtl16(larg, str);
+            _fmthex(larg, str, 0, 0);
             fmax = 0;
             break;
 
         case 'H':
             larg = va_arg(ap, long);
 
-            _prtX16(larg, str);
+            i = _fmthex(larg, str, 1, 0);
 
             larg = va_arg(ap, long);
 
-            _prtX16(larg, str + 8);
+            _fmthex(larg, str + i, 1, 8);
 
             fmax = 0;
             break;
@@ -201,11 +200,11 @@ void	_doprnt(
         case 'h':
             larg = va_arg(ap, long);
 
-            _prtl16(larg, str);
+            i = _fmthex(larg, str, 0, 0);
 
             larg = va_arg(ap, long);
 
-            _prtl16(larg, str + 8);
+            _fmthex(larg, str + i, 0, 8);
 
             fmax = 0;
             break;
@@ -279,32 +278,6 @@ void	_doprnt(
 
 }
 
-/*------------------------------------------------------------------------
- *  _prtl10  -  Converts long to base 10 string.
- *------------------------------------------------------------------------
- */
-  void		_prtl10(
-				  long		num, 
-				  char		*str
-				)
-{
-    int i;
-    char temp[11];
-
-    temp[0] = '\0';
-    temp[1] = ((num<0) ? -(num%10) : (num%10)) + '0';
-    num /= (num<0) ? -10 : 10;
-    for (i = 2; i <= 10; i++) {
-        temp[i] = num % 10 + '0';
-        num /= 10;
-    }
-    for (i = 10; temp[i] == '0'; i--);
-    if (i == 0)
-        i++;
-    while (i >= 0)
-        *str++ = temp[i--];
-}
-
 /*------------------------------------------------------------------------
  *  _prtl8  -  Converts long to base 8 string.
  *------------------------------------------------------------------------
@@ -331,56 +304,6 @@ void	_doprnt(
         *str++ = temp[i--];
 }
 
-/*------------------------------------------------------------------------
- *  _prtl16  -  Converts long to lowercase hex string.
- *------------------------------------------------------------------------
- */
-  void	_prtl16(
-		  long		num,
-		  char		*str
-		)
-{
-    int i;
-    char temp[9];
-
-    temp[0] = '\0';
-    for (i = 1; i <= 8; i++)
-    {
-        temp[i] = "0123456789abcdef"[num & 0x0F];
-        num = num >> 4;
-    }
-    for (i = 8; temp[i] == '0'; i--);
-    if (i == 0)
-        i++;
-    while (i >= 0)
-        *str++ = temp[i--];
-}
-
-/*------------------------------------------------------------------------
- *  _prtX16  -  Converts long to uppercase hex string.
- *------------------------------------------------------------------------
- */
-  void	_prtX16(
-		  long		num,
-		  char		*str
-		)
-{
-    int i;
-    char temp[9];
-
-    temp[0] = '\0';
-    for (i = 1; i <= 8; i++)
-    {
-        temp[i] = "0123456789ABCDEF"[num & 0x0F];
-        num = num >> 4;
-    }
-    for (i = 8; temp[i] == '0'; i--);
-    if (i == 0)
-        i++;
-    while (i >= 0)
-        *str++ = temp[i--];
-}
-
 /*------------------------------------------------------------------------
  *  _prtl2  -  Converts long to binary string.
  *------------------------------------------------------------------------
@@ -405,28 +328,3 @@ void	_doprnt(
     while (i >= 0)
         *str++ = temp[i--];
 }
-
-/*------------------------------------------------------------------------
- *  _prtdbl  -  Converts double to binary string.
- *------------------------------------------------------------------------
- */
-//  void	_prtdbl(
-//		  double	num,
-//		  int		precision,
-//		  char		*str
-//		)
-//{
-//    int i,mp;
-//    long w,p;
-// 
-//	for(i = 0, mp = 1; i < precision; i++, mp *= 10);
-//    
-//    num = ((num<0) ? -(num) : (num));
-//    w = (long)(num);
-//    p = (long)(num * mp) - (long)(w * mp);
-//    
-//    _prtl10(w, str);
-//    while(*str != '\0') { str++; }
-//    *str++ = '.';
-//    _prtl10(p, str);
-//}
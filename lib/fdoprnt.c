@@ -1,15 +1,17 @@
-/* fdoprnt.c - _fdoprnt, _prtl2, _prtl8, _prtl10, _prtX16, _prtl16 */
+/* fdoprnt.c - _fdoprnt, _prtl2, _prtl8 */
 
 #include <stdarg.h>
 #include <stdlib.h>
 #define	MAXSTR	80
 //#define NULL    0
 
-static void _prtl10(long num, char *str);
 static void _prtl8(long num, char *str);
-static void _prtX16(long num, char *str);
-static void _prtl16(long num, char *str);
 static void _prtl2(long num, char *str);
+extern int _fmtu10(unsigned long num, char *str);
+extern int _fmthex(unsigned long num, char *str, int upper, int mindig);
+extern int _fmtflt(float num, int prec, char *str);
+
+#define FLTPREC     16      /* most %f digits _fmtflt prints   */
 
 /*------------------------------------------------------------------------
  *  _fdoprnt  -  Format and write output using 'func' to write characters.
@@ -247,51 +249,6 @@ void    _fdoprnt2(
 }
 #endif
 
-
- 
-void float_to_string(float num, char *str, int decimals) {
-    // Manejo del signo
-    if (num < 0) {
-        *str++ = '-';
-        num = -num; // Hacer el número positivo para facilitar la conversión
-    }
-
-    // Parte entera
-    int int_part = (int)num;
-    float fraction_part = num - int_part;
-
-    // Convertir parte entera a string
-    char int_str[20]; // Buffer para la parte entera
-    int i = 0;
-
-    // Convertir la parte entera en reversa
-    do {
-        int_str[i++] = (int_part % 10) + '0';
-        int_part /= 10;
-    } while (int_part > 0);
-
-    // Agregar la parte entera a la cadena en orden correcto
-    while (i > 0) {
-        *str++ = int_str[--i];
-    }
-
-    // Manejar la parte fraccionaria
-    if (decimals > 0) {
-        *str++ = '.'; // Agregar el punto decimal
-
-        // Convertir parte fraccionaria a string
-        for (int j = 0; j < decimals; j++) {
-            fraction_part *= 10;
-            int frac_digit = (int)fraction_part;
-            *str++ = frac_digit + '0';
-            fraction_part -= frac_digit; // Remover la parte entera
-        }
-    }
-
-    *str = '\0'; // Terminar la cadena
-}
-
-
 void	_fdoprnt(
 	  char		*fmt,			/* format string	*/
 	  va_list	ap,			/* ap list of values	*/
@@ -303,7 +260,7 @@ void	_fdoprnt(
     int i;
     int f;                      /* The format character (comes after %) */
     char *str;                  /* Running pointer in string            */
-    char string[20];            /* The string str points to this output */
+    char string[64];            /* The string str points to this output */
 
     /*  from number conversion              */
     int length;                 /* Length of string "str"               */
@@ -312,9 +269,10 @@ void	_fdoprnt(
     int fmax, fmin;             /* Field specifications % MIN . MAX s   */
     int leading;                /* No. of leading/trailing fill chars   */
     char sign;                  /* Set to '-' for negative decimals     */
-    char digit1;                /* Offset to add to first numeric digit */
+    int prec;                   /* Digits after the point for %f, or -1 */
     long larg;
-    float value;
+    double darg;
+
     for (;;)
     {
         /* Echo characters until '%' or end of fmt string */
@@ -355,8 +313,9 @@ void	_fdoprnt(
                 fmin = fmin * 10 + *fmt++ - '0';
             }
         }
-        /* Allow for maximum string width for %s */
+        /* Allow for maximum string width for %s, precision for %f */
         fmax = 0;
+        prec = -1;
         if (*fmt == '.')
         {
             if (*(++fmt) == '*')
@@ -371,6 +330,7 @@ void	_fdoprnt(
                     fmax = fmax * 10 + *fmt++ - '0';
                 }
             }
+            prec = fmax;
         }
 
         str = string;
@@ -400,13 +360,21 @@ void	_fdoprnt(
             fill = ' ';
             break;
         case 'f':
-            /*value = va_arg(ap, float);
-            if (value < 0)
+            darg = va_arg(ap, double);
+
+            if (darg < 0)
             {
                 sign = '-';
-                value = -value;
-            }*/
-            //float_to_string(3,str, 2); 
+                darg = -darg;
+            }
+            /* The digits must fit in string[] after up to 39 integer */
+            /*   digits, so a larger precision prints 16 decimals    */
+            if (prec > FLTPREC)
+            {
+                prec = FLTPREC;
+            }
+            _fmtflt((float) darg, prec, str);
+            fmax = 0;
             break;
         case 'd':
             larg = va_arg(ap, long);
@@ -414,26 +382,14 @@ void	_fdoprnt(
             if (larg < 0)
             {
                 sign = '-';
-                larg = -larg;
             }
-            _prtl10(larg, str);
+            _fmtu10((larg < 0) ? -(unsigned long) larg : larg, str);
             break;
 
         case 'u':
-            digit1 = '\0';
-            /* "negative" longs in unsigned format  */
-            /* can't be computed with long division */
-            /* convert *args to "positive", digit1  */
-            /* = how much to add back afterwards    */
             larg = va_arg(ap, long);
 
-            while (larg < 0)
-            {
-                larg -= 1000000000L;
-                ++digit1;
-            }
-            _prtl10(larg, str);
-            str[0] += digit1;
+            _fmtu10(larg, str);
             fmax = 0;
             break;
 
@@ -447,14 +403,14 @@ void	_fdoprnt(
         case 'X':
             larg = va_arg(ap, long);
 
-            _prtX16(larg, str);
+            _fmthex(larg, str, 1, 0);
             fmax = 0;
             break;
 
         case 'x':
             larg = va_arg(ap, long);
 
-            _prtl16(larg, str);
+            _fmthex(larg, str, 0, 0);
             fmax = 0;
             break;
 
@@ -527,31 +483,6 @@ void	_fdoprnt(
 
 }
 
-/*------------------------------------------------------------------------
- *  _prtl10  -  Converts long to base 10 string.
- *------------------------------------------------------------------------
- */
-static void	_prtl10(
-		  long		num,
-		  char		*str
-		)
-{
-    int i;
-    char temp[11];
-
-    temp[0] = '\0';
-    for (i = 1; i <= 10; i++)
-    {
-        temp[i] = num % 10 + '0';
-        num /= 10;
-    }
-    for (i = 10; temp[i] == '0'; i--);
-    if (i == 0)
-        i++;
-    while (i >= 0)
-        *str++ = temp[i--];
-}
-
 /*------------------------------------------------------------------------
  *  _prtl8  -  Converts long to base 8 string.
  *------------------------------------------------------------------------
@@ -578,56 +509,6 @@ static void	_prtl8(
         *str++ = temp[i--];
 }
 
-/*------------------------------------------------------------------------
- *  _prtl16  -  Converts long to lowercase hex string.
- *------------------------------------------------------------------------
- */
-static void	_prtl16(
-		  long		num,
-		  char		*str
-		)
-{
-    int i;
-    char temp[9];
-
-    temp[0] = '\0';
-    for (i = 1; i <= 8; i++)
-    {
-        temp[i] = "0123456789abcdef"[num & 0x0F];
-        num = num >> 4;
-    }
-    for (i = 8; temp[i] == '0'; i--);
-    if (i == 0)
-        i++;
-    while (i >= 0)
-        *str++ = temp[i--];
-}
-
-/*------------------------------------------------------------------------
- *  _prtX16  -  Converts long to uppercase hex string.
- *------------------------------------------------------------------------
- */
-static void	_prtX16(
-		  long		num,
-		  char		*str
-		)
-{
-    int i;
-    char temp[9];
-
-    temp[0] = '\0';
-    for (i = 1; i <= 8; i++)
-    {
-        temp[i] = "0123456789ABCDEF"[num & 0x0F];
-        num = num >> 4;
-    }
-    for (i = 8; temp[i] == '0'; i--);
-    if (i == 0)
-        i++;
-    while (i >= 0)
-        *str++ = temp[i--];
-}
-
 /*------------------------------------------------------------------------
  *  _prtl2  -  Converts long to binary string.
  *------------------------------------------------------------------------
@@ -0,0 +1,287 @@
+/* fmtnum.c - _fmtu10, _fmthex, _fmtflt */
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------
+ * Number conversion shared by _doprnt (kprintf) and _fdoprnt (printf,
+ * fprintf, sprintf).  Decimal digits are produced two at a time from a
+ * table, and division by 100 is a multiply by its reciprocal, so only
+ * floats of 2^32 and above need a divide routine.
+ *------------------------------------------------------------------------
+ */
+
+static const char pairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+static const uint32_t tens[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000
+};
+
+#define FLTPREC     16      /* most digits printed after the point */
+
+/* n / 100 for any 32-bit n (0x51EB851F = ceil(2^37 / 100)) */
+#define div100(n)   ((uint32_t) (((uint64_t) (n) * 0x51EB851FU) >> 37))
+
+/*------------------------------------------------------------------------
+ *  _fmtu10  -  Convert an unsigned long to a decimal string, returning
+ *		its length
+ *------------------------------------------------------------------------
+ */
+int _fmtu10(
+      unsigned long num,
+      char      *str
+    )
+{
+    char temp[10];
+    char *p = temp + sizeof(temp);
+    uint32_t n = num;
+    uint32_t q;
+    int len;
+
+    while (n >= 100)
+    {
+        q = div100(n);
+        p -= 2;
+        p[0] = pairs[2 * (n - q * 100)];
+        p[1] = pairs[2 * (n - q * 100) + 1];
+        n = q;
+    }
+    if (n >= 10)
+    {
+        p -= 2;
+        p[0] = pairs[2 * n];
+        p[1] = pairs[2 * n + 1];
+    }
+    else
+    {
+        *--p = '0' + n;
+    }
+
+    len = temp + sizeof(temp) - p;
+    while (p < temp + sizeof(temp))
+    {
+        *str++ = *p++;
+    }
+    *str = '\0';
+    return len;
+}
+
+/*------------------------------------------------------------------------
+ *  _fmthex  -  Convert an unsigned long to a hex string of at least
+ *		mindig digits, returning its length
+ *------------------------------------------------------------------------
+ */
+int _fmthex(
+      unsigned long num,
+      char      *str,
+      int       upper,      /* nonzero for A-F                  */
+      int       mindig      /* digits to zero fill to (max 8)   */
+    )
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    uint32_t n = num;
+    int len;
+    int i;
+
+    /* The number of digits follows from the highest bit set */
+    len = (32 - __builtin_clz(n | 1) + 3) >> 2;
+    if (mindig > 8)
+    {
+        mindig = 8;
+    }
+    if (len < mindig)
+    {
+        len = mindig;
+    }
+    for (i = len - 1; i >= 0; i--)
+    {
+        str[i] = digits[n & 0x0F];
+        n >>= 4;
+    }
+    str[len] = '\0';
+    return len;
+}
+
+/*------------------------------------------------------------------------
+ *  fmtbig  -  Convert an integer of up to five 32-bit words (least
+ *		significant first) to decimal; the words are destroyed
+ *------------------------------------------------------------------------
+ */
+static int fmtbig(
+      uint32_t  *w,
+      int       nw,
+      char      *str
+    )
+{
+    char temp[50];
+    char *p = temp + sizeof(temp);
+    uint64_t rem;
+    int i, len;
+
+    /* Divide by 10^9 until the number fits in a word */
+    while (nw > 1)
+    {
+        rem = 0;
+        for (i = nw - 1; i >= 0; i--)
+        {
+            rem = (rem << 32) | w[i];
+            w[i] = (uint32_t) (rem / 1000000000U);
+            rem %= 1000000000U;
+        }
+        for (i = 0; i < 9; i++)
+        {
+            *--p = '0' + (uint32_t) rem % 10;
+            rem = (uint32_t) rem / 10;
+        }
+        while (nw > 1 && w[nw - 1] == 0)
+        {
+            nw--;
+        }
+    }
+
+    len = _fmtu10(w[0], str);
+    for (i = 0; p < temp + sizeof(temp); i++)
+    {
+        str[len++] = *p++;
+    }
+    str[len] = '\0';
+    return len;
+}
+
+/*------------------------------------------------------------------------
+ *  _fmtflt  -  Convert the magnitude of a float to "int.frac" with prec
+ *		digits after the point, correctly rounded (ties to even)
+ *		from the exact binary value; returns the length, which is
+ *		at most 56.  prec is at most FLTPREC (16); the callers
+ *		clamp it.  Digits past the ninth are printed as zeros.
+ *		The caller prints the sign.
+ *------------------------------------------------------------------------
+ */
+int _fmtflt(
+      float     num,
+      int       prec,
+      char      *str
+    )
+{
+    union { float f; uint32_t u; } bits;
+    uint32_t mant, ipart, fpart, scale;
+    uint32_t w[5];
+    uint64_t frac, half, rem;
+    int exp, shift, len, i;
+
+    bits.f = num;
+    exp = (bits.u >> 23) & 0xFF;
+    mant = bits.u & 0x7FFFFF;
+    if (exp == 0xFF)
+    {
+        str[0] = mant ? 'n' : 'i';
+        str[1] = mant ? 'a' : 'n';
+        str[2] = mant ? 'n' : 'f';
+        str[3] = '\0';
+        return 3;
+    }
+    if (exp == 0)
+    {
+        exp = 1;            /* subnormal */
+    }
+    else
+    {
+        mant |= 0x800000;
+    }
+    exp -= 150;             /* value = mant * 2^exp */
+
+    if (prec < 0)
+    {
+        prec = 6;
+    }
+    if (prec > FLTPREC)
+    {
+        prec = FLTPREC;
+    }
+    scale = tens[prec > 9 ? 9 : prec];
+
+    /* Split into integer and fraction; fraction is frac / 2^shift */
+    if (exp >= 0)
+    {
+        frac = 0;
+        shift = 0;
+        if (exp <= 8)
+        {
+            ipart = mant << exp;
+            len = _fmtu10(ipart, str);
+        }
+        else
+        {
+            for (i = 0; i < 5; i++)
+            {
+                w[i] = 0;
+            }
+            w[exp >> 5] = mant << (exp & 31);
+            if ((exp & 31) != 0)
+            {
+                w[(exp >> 5) + 1] = mant >> (32 - (exp & 31));
+            }
+            len = fmtbig(w, 5, str);
+        }
+        fpart = 0;
+    }
+    else
+    {
+        shift = -exp;
+        ipart = (shift < 32) ? mant >> shift : 0;
+        frac = (shift < 32) ? mant & ((1U << shift) - 1) : mant;
+
+        /* Scale the fraction to prec digits and round; frac < 2^24 */
+        /*   and scale < 2^30, so the product fits in 64 bits      */
+        if (shift >= 64)
+        {
+            fpart = 0;      /* far below the last digit */
+        }
+        else
+        {
+            frac *= scale;
+            fpart = (uint32_t) (frac >> shift);
+            rem = frac - ((uint64_t) fpart << shift);
+            half = (uint64_t) 1 << (shift - 1);
+            if (rem > half || (rem == half
+                               && ((prec > 0 ? fpart : ipart) & 1)))
+            {
+                fpart++;
+            }
+        }
+        if (fpart >= scale)
+        {
+            fpart -= scale;
+            ipart++;
+        }
+        len = _fmtu10(ipart, str);
+    }
+
+    if (prec > 0)
+    {
+        str[len++] = '.';
+        for (i = (prec > 9 ? 9 : prec) - 1; i >= 0; i--)
+        {
+            str[len + i] = '0' + fpart % 10;
+            fpart /= 10;
+        }
+        len += (prec > 9 ? 9 : prec);
+        for (i = 9; i < prec; i++)
+        {
+            str[len++] = '0';
+        }
+    }
+    str[len] = '\0';
+    return len;
+}
@@ -3,7 +3,7 @@
 #include <xinu.h>
 //#include <stdarg.h>
 
-extern void _fdoprnt(char *, va_list, int (*)(did32, char), int);
+extern void _fdoprnt(char *, va_list, int (*)(int, int), int);
 
 /*------------------------------------------------------------------------
  *  fprintf  -  Print a formatted message on specified device (file).
@@ -25,7 +25,7 @@ int	fprintf(
     
 
     va_start(ap, fmt);
-    _fdoprnt(fmt, ap, putc, dev);
+    _fdoprnt(fmt, ap, bufputc, dev);
     va_end(ap);
 
     return 0;
@@ -20,7 +20,7 @@ int	fputc(
 	  int		dev		/* device to use		*/
 	)
 {
-    if (SYSERR == (int)putc(dev, c))
+    if (SYSERR == bufputc(dev, c))
     {
         return EOF;
     }
@@ -22,7 +22,7 @@ int	fputs(
 
     while ((c = (*s++)))
     {
-	        r = putc(dev, c);
+	        r = bufputc(dev, c);
     }
     return r;
 }
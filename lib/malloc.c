@@ -10,16 +10,318 @@
 
 #include <xinu.h>
 
+/* Size classes, smallest first; every size is a multiple of 8 */
+
+struct slabclass slabtab[NSLAB] = {
+    {8}, {16}, {24}, {32}, {48}, {64}, {96}, {128}, {192}, {256}
+};
+
+/* Class for each request size rounded up to 8, indexed by size / 8 */
+
+static const byte slabidx[SLABMAX / 8 + 1] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+    8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9
+};
+
+/* One bit per heap page that is a slab page */
+
+#define SLABMAPLEN  (((1U << MFLMAX) / PAGE_SIZE + 31) / 32)
+
+static uint32 slabmap[SLABMAPLEN];
+
+#define slabpageof(p)   ((struct slabpage *)((uint32)(p) & ~(PAGE_SIZE - 1)))
+#define slabbit(pg)     (((uint32)(pg) - ((uint32)minheap & ~(PAGE_SIZE - 1))) \
+                         / PAGE_SIZE)
+
+/* A slab page is its header, one owner byte per object, then the
+ * objects themselves starting on an 8-byte boundary */
+
+#define slabowners(pg)  ((byte *)((pg) + 1))
+#define slabobjs(pg, n) ((char *)slabowners(pg) + (uint32)roundmb(n))
 
 /**
- * Request heap storage, record accounting information, returning pointer
- * to assigned memory region.
+ * Work out how many objects of a class fit in a page with their owner
+ * bytes, the first time the class needs a page.
+ * @param scptr size class
+ */
+static void slabgeom(struct slabclass *scptr)
+{
+    uint32 n;
+
+    n = (PAGE_SIZE - sizeof(struct slabpage)) / (scptr->ssize + 1);
+    while (sizeof(struct slabpage) + (uint32)roundmb(n)
+           + n * scptr->ssize > PAGE_SIZE)
+    {
+        n--;
+    }
+    scptr->snobj = n;
+}
+
+/**
+ * Take an object from a size class, adding a page to the class when
+ * none of its pages has a free object.  Assumes interrupts disabled.
+ * @param cls index of the size class
+ * @return pointer to the object, NULL if no page could be allocated
+ */
+static void *slaballoc(int cls)
+{
+    struct slabclass *scptr = &slabtab[cls];
+    struct slabpage *pg;
+    char *obj;
+    uint32 bit;
+    int i;
+
+    pg = scptr->spages;
+    if (NULL == pg)
+    {
+        pg = (struct slabpage *)getalign(PAGE_SIZE, PAGE_SIZE);
+        if (SYSERR == (uint32)pg)
+        {
+            return NULL;
+        }
+        if (0 == scptr->snobj)
+        {
+            slabgeom(scptr);
+        }
+
+        /* thread every object of the new page onto its free list */
+        pg->sfree = NULL;
+        for (i = scptr->snobj - 1; i >= 0; i--)
+        {
+            obj = slabobjs(pg, scptr->snobj) + i * scptr->ssize;
+            *(void **)obj = pg->sfree;
+            pg->sfree = obj;
+            slabowners(pg)[i] = SLABNOOWNER;
+        }
+        pg->sclass = cls;
+        pg->sinuse = 0;
+        pg->sprev = NULL;
+        pg->snext = NULL;
+        scptr->spages = pg;
+        scptr->snpages++;
+        bit = slabbit(pg);
+        slabmap[bit >> 5] |= 1U << (bit & 31);
+    }
+
+    obj = pg->sfree;
+    pg->sfree = *(void **)obj;
+    pg->sinuse++;
+    scptr->sinuse++;
+    scptr->sallocs++;
+    slabowners(pg)[(obj - slabobjs(pg, scptr->snobj)) / scptr->ssize]
+        = currpid;
+    proctab[currpid].prheap += scptr->ssize;
+
+    /* a full page leaves the list of pages with free objects */
+    if (NULL == pg->sfree)
+    {
+        scptr->spages = pg->snext;
+        if (pg->snext)
+        {
+            pg->snext->sprev = NULL;
+        }
+    }
+    return obj;
+}
+
+/**
+ * Return an object to its page.  An empty page goes back to the heap
+ * unless it is the last page of its class.  Assumes interrupts disabled.
+ * @param pg page that holds the object
+ * @param obj object to free
+ */
+static void slabfree(struct slabpage *pg, void *obj)
+{
+    struct slabclass *scptr = &slabtab[pg->sclass];
+    byte *owner;
+    uint32 bit;
+
+    /* objects already free are left alone */
+    owner = &slabowners(pg)[((char *)obj - slabobjs(pg, scptr->snobj))
+                            / scptr->ssize];
+    if (SLABNOOWNER == *owner)
+    {
+        return;
+    }
+    proctab[*owner].prheap -= scptr->ssize;
+    *owner = SLABNOOWNER;
+
+    /* a full page rejoins the list of pages with free objects */
+    if (NULL == pg->sfree)
+    {
+        pg->sprev = NULL;
+        pg->snext = scptr->spages;
+        if (scptr->spages)
+        {
+            scptr->spages->sprev = pg;
+        }
+        scptr->spages = pg;
+    }
+    *(void **)obj = pg->sfree;
+    pg->sfree = obj;
+    pg->sinuse--;
+    scptr->sinuse--;
+    scptr->sfrees++;
+
+    if (0 == pg->sinuse && scptr->snpages > 1)
+    {
+        if (pg->sprev)
+        {
+            pg->sprev->snext = pg->snext;
+        }
+        else
+        {
+            scptr->spages = pg->snext;
+        }
+        if (pg->snext)
+        {
+            pg->snext->sprev = pg->sprev;
+        }
+        scptr->snpages--;
+        bit = slabbit(pg);
+        slabmap[bit >> 5] &= ~(1U << (bit & 31));
+        freemem((char *)pg, PAGE_SIZE);
+    }
+}
+
+/**
+ * Tell whether a pointer is an object in a slab page.
+ * @param pmem pointer passed to free or realloc
+ * @return TRUE if the pointer lies in a slab page
+ */
+static bool8 isslab(void *pmem)
+{
+    uint32 bit;
+
+    if ((uint32)pmem < (uint32)minheap || (uint32)pmem >= (uint32)maxheap)
+    {
+        return FALSE;
+    }
+    bit = slabbit(slabpageof(pmem));
+    return (slabmap[bit >> 5] >> (bit & 31)) & 1;
+}
+
+/**
+ * Check the accounting info of a large block, which is linked on the
+ * list of blocks its owner holds.  Assumes interrupts disabled.
+ * @param block accounting info in front of the region
+ * @return TRUE if the block is a live malloc block
+ */
+static bool8 isblock(struct memblk *block)
+{
+    if (block->mowner < 0 || block->mowner >= NPROC)
+    {
+        return FALSE;
+    }
+    if (NULL == block->mprev)
+    {
+        return proctab[block->mowner].prmlist == block;
+    }
+    return block->mprev->mnext == block;
+}
+
+/**
+ * Link a large block onto the list of blocks a process owns.  Assumes
+ * interrupts disabled.
+ * @param block accounting info in front of the region
+ * @param pid new owner of the block
+ */
+static void blocklink(struct memblk *block, pid32 pid)
+{
+    struct procent *prptr = &proctab[pid];
+
+    block->mowner = pid;
+    block->mprev = NULL;
+    block->mnext = prptr->prmlist;
+    if (block->mnext)
+    {
+        block->mnext->mprev = block;
+    }
+    prptr->prmlist = block;
+    prptr->prheap += block->mlength;
+}
+
+/**
+ * Unlink a large block from the list of its owner.  Assumes interrupts
+ * disabled.
+ * @param block accounting info in front of the region
+ */
+static void blockunlink(struct memblk *block)
+{
+    struct procent *prptr = &proctab[block->mowner];
+
+    if (block->mprev)
+    {
+        block->mprev->mnext = block->mnext;
+    }
+    else
+    {
+        prptr->prmlist = block->mnext;
+    }
+    if (block->mnext)
+    {
+        block->mnext->mprev = block->mprev;
+    }
+    prptr->prheap -= block->mlength;
+}
+
+/**
+ * Unlink a large block from its owner and give it back to the kernel.
+ * Assumes interrupts disabled.
+ * @param block accounting info in front of the region
+ */
+static void blockfree(struct memblk *block)
+{
+    blockunlink(block);
+    block->mowner = -1;
+    freemem((char *)block, block->mlength);
+}
+
+#if MEMTRACE
+struct memsite memsites[NMEMSITE];
+uint32 memsitemiss;
+
+/**
+ * Count an allocation against the call site it came from.  Sites fill
+ * the table in the order they are first seen.
+ * @param pc return address of the allocating call
+ * @param nbytes bytes the call asked for
+ */
+static void sitecount(void *pc, uint32 nbytes)
+{
+    intmask mask;
+    int i;
+
+    mask = disable();
+    for (i = 0; i < NMEMSITE; i++)
+    {
+        if (NULL == memsites[i].mspc)
+        {
+            memsites[i].mspc = pc;
+        }
+        if (memsites[i].mspc == pc)
+        {
+            memsites[i].mscalls++;
+            memsites[i].msbytes += nbytes;
+            restore(mask);
+            return;
+        }
+    }
+    memsitemiss++;
+    restore(mask);
+}
+#endif
+
+/**
+ * Allocate from a slab or the heap on behalf of malloc, calloc and
+ * realloc.
  * @param nbytes number of bytes requested
  * @return pointer to region on success, NULL on failure
  */
-void *malloc(uint32 nbytes)
+static void *memalloc(uint32 nbytes)
 {
     struct memblk *pmem;
+    intmask mask;
 
     /* we don't allocate 0 bytes. */
     if (0 == nbytes)
@@ -27,6 +329,15 @@ void *malloc(uint32 nbytes)
         return NULL;
     }
 
+    /* small requests come from a slab, without a header */
+    if (nbytes <= SLABMAX)
+    {
+        mask = disable();
+        pmem = slaballoc(slabidx[(nbytes + 7) >> 3]);
+        restore(mask);
+        return pmem;
+    }
+
     /* make room for accounting info */
     nbytes += sizeof(struct memblk);
 
@@ -37,16 +348,47 @@ void *malloc(uint32 nbytes)
         return NULL;
     }
 
-    /* set accounting info */
-    pmem->mnext = pmem;
+    /* set accounting info and link onto the owner's list */
+    mask = disable();
     pmem->mlength = nbytes;
+    blocklink(pmem, currpid);
+    restore(mask);
 
     return (void *)(pmem + 1);  /* +1 to skip accounting info */
 }
 
+/**
+ * Request heap storage, record accounting information, returning pointer
+ * to assigned memory region.  The region belongs to the calling process
+ * and is reclaimed when that process is killed.
+ * @param nbytes number of bytes requested
+ * @return pointer to region on success, NULL on failure
+ */
+void *malloc(uint32 nbytes)
+{
+#if MEMTRACE
+    sitecount(__builtin_return_address(0), nbytes);
+#endif
+    return memalloc(nbytes);
+}
+
 void free(void *pmem)
 {
     struct memblk *block;
+    intmask mask;
+
+    if (NULL == pmem)
+    {
+        return;
+    }
+
+    mask = disable();
+    if (isslab(pmem))
+    {
+        slabfree(slabpageof(pmem), pmem);
+        restore(mask);
+        return;
+    }
 
     /* block points at the memblock we want to free */
     block = (struct memblk *)pmem;
@@ -55,32 +397,182 @@ void free(void *pmem)
     block--;
 
     /* don't memfree if we fail basic checks */
-    if (block->mnext != block)
+    if (isblock(block))
     {
-        return;
+        blockfree(block);
     }
+    restore(mask);
+}
 
-    freemem((char *)block, block->mlength);
+/**
+ * Free everything a process allocated with malloc.  Called by kill with
+ * interrupts disabled.
+ * @param pid process whose allocations are reclaimed
+ */
+void heapreclaim(pid32 pid)
+{
+    struct procent *prptr = &proctab[pid];
+    struct slabpage *pg;
+    struct slabclass *scptr;
+    uint32 bit;
+    bool8 last;
+    int i;
+
+    while (prptr->prmlist)
+    {
+        blockfree(prptr->prmlist);
+    }
+
+    /* visit every slab page; a page may be freed as it empties */
+    for (bit = 0; prptr->prheap != 0 && bit < SLABMAPLEN * 32; bit++)
+    {
+        if (0 == ((slabmap[bit >> 5] >> (bit & 31)) & 1))
+        {
+            continue;
+        }
+        pg = (struct slabpage *)(((uint32)minheap & ~(PAGE_SIZE - 1))
+                                 + bit * PAGE_SIZE);
+        scptr = &slabtab[pg->sclass];
+        for (i = 0; i < scptr->snobj; i++)
+        {
+            if (slabowners(pg)[i] != pid)
+            {
+                continue;
+            }
+
+            /* the page may go back to the heap with its last object,
+             * so decide before freeing and never touch it afterwards */
+            last = (1 == pg->sinuse);
+            slabfree(pg, slabobjs(pg, scptr->snobj) + i * scptr->ssize);
+            if (last)
+            {
+                break;
+            }
+        }
+    }
 }
+
+/**
+ * Make another process the owner of an allocation, so that it is
+ * counted against that process and reclaimed when that process is
+ * killed rather than when the one that called malloc is.
+ * @param pmem pointer returned by malloc, calloc or realloc
+ * @param pid process that takes the allocation over
+ * @return OK on success, SYSERR if pmem is not allocated or pid is bad
+ */
+syscall heapgive(void *pmem, pid32 pid)
+{
+    struct slabclass *scptr;
+    struct slabpage *pg;
+    struct memblk *block;
+    byte *owner;
+    intmask mask;
+
+    mask = disable();
+    if (isbadpid(pid) || PR_FREE == proctab[pid].prstate || NULL == pmem)
+    {
+        restore(mask);
+        return SYSERR;
+    }
+    if (isslab(pmem))
+    {
+        pg = slabpageof(pmem);
+        scptr = &slabtab[pg->sclass];
+        owner = &slabowners(pg)[((char *)pmem - slabobjs(pg, scptr->snobj))
+                                / scptr->ssize];
+        if (SLABNOOWNER == *owner)
+        {
+            restore(mask);
+            return SYSERR;
+        }
+        proctab[*owner].prheap -= scptr->ssize;
+        proctab[pid].prheap += scptr->ssize;
+        *owner = pid;
+        restore(mask);
+        return OK;
+    }
+
+    block = (struct memblk *)pmem - 1;
+    if (!isblock(block))
+    {
+        restore(mask);
+        return SYSERR;
+    }
+    if (block->mowner != pid)
+    {
+        blockunlink(block);
+        blocklink(block, pid);
+    }
+    restore(mask);
+    return OK;
+}
+
+/**
+ * Change the size of an allocation, keeping it in place when possible.
+ * A slab object stays put while the new size fits its class; a larger
+ * block shrinks in place or grows into the free block after it.
+ * Otherwise the data moves, copying only the bytes both sizes hold.
+ * @param ptr allocation to resize, or NULL to allocate
+ * @param size new size in bytes, or 0 to free
+ * @return pointer to the resized region, NULL on failure
+ */
 void* realloc(void* ptr, size_t size)
 {
     void* new_data = NULL;
+    struct memblk *block;
+    uint32 oldsize;
+    intmask mask;
 
-    if(size)
+    if (!size)
     {
-        if(!ptr)
+        free(ptr);
+        return NULL;
+    }
+#if MEMTRACE
+    sitecount(__builtin_return_address(0), size);
+#endif
+    if (!ptr)
+    {
+        return memalloc(size);
+    }
+
+    mask = disable();
+    if (isslab(ptr))
+    {
+        oldsize = slabtab[slabpageof(ptr)->sclass].ssize;
+        restore(mask);
+        if (size <= oldsize)
         {
-            return malloc(size);
+            return ptr;
         }
-
-        new_data = malloc(size);
-        if(new_data)
+    }
+    else
+    {
+        block = (struct memblk *)ptr - 1;
+        if (!isblock(block))
+        {
+            restore(mask);
+            return NULL;
+        }
+        oldsize = block->mlength - sizeof(struct memblk);
+        if (OK == resizemem((char *)block, block->mlength,
+                            size + sizeof(struct memblk)))
         {
-            memcpy(new_data, ptr, size); // TODO: unsafe copy...
-            free(ptr); // we always move the data. free.
+            proctab[block->mowner].prheap += size + sizeof(struct memblk);
+            proctab[block->mowner].prheap -= block->mlength;
+            block->mlength = size + sizeof(struct memblk);
+            restore(mask);
+            return ptr;
         }
+        restore(mask);
     }
 
+    new_data = memalloc(size);
+    if (new_data)
+    {
+        memcpy(new_data, ptr, size < oldsize ? size : oldsize);
+        free(ptr);
+    }
     return new_data;
 }
 
@@ -90,7 +582,10 @@ void            *calloc(size_t nmemb, size_t size)
   char          *ptr;
 
   s = nmemb * size;
-  if ((ptr = malloc(s)) == NULL)
+#if MEMTRACE
+  sitecount(__builtin_return_address(0), s);
+#endif
+  if ((ptr = memalloc(s)) == NULL)
     return (NULL);
   memset(ptr, 0, s);
   return (ptr);
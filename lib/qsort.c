@@ -1,162 +1,535 @@
-/* qsort.c - qsort, qs1, qsexc, qstexc */
+/* qsort.c - qsort, qsort_r, msort, msort_r */
 
-static int (*qscmp) (char *, char *);
-static int qses;
-static void qs1(char *, char *);
-static void qsexc(char *, char *);
-static void qstexc(char *, char *, char *);
+#include <stdlib.h>
 
 /*------------------------------------------------------------------------
- *  qsort  -  Use quicksort to sort an array
+ * All sort state lives in a struct on the caller's stack, so processes
+ * may sort at the same time.  qsort is an introsort: quicksort with a
+ * median-of-3 pivot that recurses only into the smaller side, falls
+ * back to heapsort when it goes too deep, and finishes short ranges
+ * with insertion sort.  Stack use is O(log n) either way.  msort is a
+ * stable merge sort that merges in place by rotation, so it needs no
+ * memory beyond its O(log n) recursion.
+ *------------------------------------------------------------------------
+ */
+
+#define QSCUTOFF    12          /* Ranges this short use insertion  */
+#define MSBLOCK     16          /* Run length msort starts merging  */
+
+#define SWAPBYTES   0           /* Swap a byte at a time            */
+#define SWAPWORDS   1           /* Swap aligned 32-bit words        */
+#define SWAPONE     2           /* Element is one aligned word      */
+#define SWAPTWO     3           /* Element is two aligned words     */
+
+struct sortctx
+{
+    char *base;                 /* First element of the array       */
+    size_t es;                  /* Size of an element in bytes      */
+    int swaptype;               /* SWAPBYTES ... SWAPTWO            */
+    int (*cmp) (const void *, const void *, void *);
+    void *arg;                  /* Passed through to cmp            */
+};
+
+/* Adapts a two-argument comparator for qsort and msort */
+struct cmp2
+{
+    int (*cmp) (const void *, const void *);
+};
+
+static void sortinit(struct sortctx *, void *, size_t,
+                     int (*)(const void *, const void *, void *), void *);
+static int cmp2call(const void *, const void *, void *);
+static void qsswap(struct sortctx *, char *, char *);
+static void qsinsert(struct sortctx *, char *, size_t);
+static void qsheap(struct sortctx *, char *, size_t);
+static void qsintro(struct sortctx *, char *, size_t, int);
+static void msreverse(struct sortctx *, size_t, size_t);
+static void msmerge(struct sortctx *, size_t, size_t, size_t);
+
+/*------------------------------------------------------------------------
+ *  qsort  -  Sort an array with introsort
  *------------------------------------------------------------------------
  */
 void	qsort(
-	  char		*a,		/* Array to sort		*/
-	  unsigned	n,		/* Length of the array		*/
-	  int		es,		/* Pivot value			*/
-	  int		(*fc)(char *, char *)	/* Comparison function	*/
+	  void		*a,		/* Array to sort		*/
+	  size_t	n,		/* Number of elements		*/
+	  size_t	es,		/* Size of an element		*/
+	  int		(*fc)(const void *, const void *) /* Comparison	*/
 	)
 {
-    qscmp = fc;
-    qses = es;
-    qs1(a, a + n * es);
+    struct cmp2 c2;
+
+    c2.cmp = fc;
+    qsort_r(a, n, es, cmp2call, &c2);
 }
 
 /*------------------------------------------------------------------------
- *  qs1  -  internal quicksort function
+ *  qsort_r  -  Sort an array with introsort, passing arg to every call
+ *		of the comparison function
  *------------------------------------------------------------------------
  */
-static void	qs1(
-		  char		*a,
-		  char		*l
+void	qsort_r(
+	  void		*a,		/* Array to sort		*/
+	  size_t	n,		/* Number of elements		*/
+	  size_t	es,		/* Size of an element		*/
+	  int		(*fc)(const void *, const void *, void *),
+	  void		*arg		/* Context for fc		*/
+	)
+{
+    struct sortctx ctx;
+    int depth;
+    size_t m;
+
+    if (n < 2 || es == 0)
+    {
+        return;
+    }
+    sortinit(&ctx, a, es, fc, arg);
+
+    /* Allow 2 * log2(n) levels of partitioning before heapsort */
+    depth = 0;
+    for (m = n; m > 1; m >>= 1)
+    {
+        depth += 2;
+    }
+    qsintro(&ctx, ctx.base, n, depth);
+}
+
+/*------------------------------------------------------------------------
+ *  msort  -  Sort an array stably, without allocating memory
+ *------------------------------------------------------------------------
+ */
+void	msort(
+	  void		*a,		/* Array to sort		*/
+	  size_t	n,		/* Number of elements		*/
+	  size_t	es,		/* Size of an element		*/
+	  int		(*fc)(const void *, const void *) /* Comparison	*/
+	)
+{
+    struct cmp2 c2;
+
+    c2.cmp = fc;
+    msort_r(a, n, es, cmp2call, &c2);
+}
+
+/*------------------------------------------------------------------------
+ *  msort_r  -  Sort an array stably, passing arg to every call of the
+ *		comparison function
+ *------------------------------------------------------------------------
+ */
+void	msort_r(
+	  void		*a,		/* Array to sort		*/
+	  size_t	n,		/* Number of elements		*/
+	  size_t	es,		/* Size of an element		*/
+	  int		(*fc)(const void *, const void *, void *),
+	  void		*arg		/* Context for fc		*/
+	)
+{
+    struct sortctx ctx;
+    size_t lo, width;
+
+    if (n < 2 || es == 0)
+    {
+        return;
+    }
+    sortinit(&ctx, a, es, fc, arg);
+
+    /* Insertion sort is stable; use it for the first runs */
+    for (lo = 0; lo < n; lo += MSBLOCK)
+    {
+        qsinsert(&ctx, ctx.base + lo * es,
+                 (n - lo < MSBLOCK) ? n - lo : MSBLOCK);
+    }
+
+    /* Then merge neighbouring runs of doubling width */
+    for (width = MSBLOCK; width < n; width *= 2)
+    {
+        for (lo = 0; lo + width < n; lo += 2 * width)
+        {
+            msmerge(&ctx, lo, lo + width,
+                    (n - lo < 2 * width) ? n : lo + 2 * width);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------
+ *  sortinit  -  Fill in the sort state and choose how to swap elements
+ *------------------------------------------------------------------------
+ */
+static void	sortinit(
+		  struct sortctx *ctx,
+		  void		*a,
+		  size_t	es,
+		  int		(*fc)(const void *, const void *, void *),
+		  void		*arg
+		)
+{
+    ctx->base = a;
+    ctx->es = es;
+    ctx->cmp = fc;
+    ctx->arg = arg;
+    if (((unsigned long) a & 3) != 0 || (es & 3) != 0)
+    {
+        ctx->swaptype = SWAPBYTES;
+    }
+    else if (es == 4)
+    {
+        ctx->swaptype = SWAPONE;
+    }
+    else if (es == 8)
+    {
+        ctx->swaptype = SWAPTWO;
+    }
+    else
+    {
+        ctx->swaptype = SWAPWORDS;
+    }
+}
+
+/*------------------------------------------------------------------------
+ *  cmp2call  -  Call a two-argument comparator through qsort_r
+ *------------------------------------------------------------------------
+ */
+static int	cmp2call(
+		  const void	*a,
+		  const void	*b,
+		  void		*arg
 		)
 {
-    register char *i, *j;
-    register int es;
-    char *lp, *hp;
-    int c;
-    unsigned n;
+    return ((struct cmp2 *) arg)->cmp(a, b);
+}
 
-    es = qses;
+/*------------------------------------------------------------------------
+ *  qsswap  -  Exchange two elements
+ *------------------------------------------------------------------------
+ */
+static void	qsswap(
+		  struct sortctx *ctx,
+		  char		*i,
+		  char		*j
+		)
+{
+    uint32_t *wi, *wj, w;
+    char c;
+    size_t n;
 
-  start:
-    if ((n = l - a) <= es)
+    switch (ctx->swaptype)
     {
+    case SWAPONE:
+        w = *(uint32_t *) i;
+        *(uint32_t *) i = *(uint32_t *) j;
+        *(uint32_t *) j = w;
+        return;
+
+    case SWAPTWO:
+        wi = (uint32_t *) i;
+        wj = (uint32_t *) j;
+        w = wi[0];
+        wi[0] = wj[0];
+        wj[0] = w;
+        w = wi[1];
+        wi[1] = wj[1];
+        wj[1] = w;
+        return;
+
+    case SWAPWORDS:
+        wi = (uint32_t *) i;
+        wj = (uint32_t *) j;
+        for (n = ctx->es / 4; n > 0; n--)
+        {
+            w = *wi;
+            *wi++ = *wj;
+            *wj++ = w;
+        }
+        return;
+
+    default:
+        for (n = ctx->es; n > 0; n--)
+        {
+            c = *i;
+            *i++ = *j;
+            *j++ = c;
+        }
         return;
     }
-    n = es * (n / (2 * es));
-    hp = lp = a + n;
-    i = a;
-    j = l - es;
-    for (;;)
+}
+
+/*------------------------------------------------------------------------
+ *  qsinsert  -  Insertion sort a short range (stable)
+ *------------------------------------------------------------------------
+ */
+static void	qsinsert(
+		  struct sortctx *ctx,
+		  char		*a,
+		  size_t	n
+		)
+{
+    char *i, *j;
+    char *end;
+    size_t es;
+
+    es = ctx->es;
+    end = a + n * es;
+    for (i = a + es; i < end; i += es)
+    {
+        for (j = i; j > a && ctx->cmp(j - es, j, ctx->arg) > 0; j -= es)
+        {
+            qsswap(ctx, j - es, j);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------
+ *  qsheap  -  Heapsort a range whose partitioning went too deep
+ *------------------------------------------------------------------------
+ */
+static void	qsheap(
+		  struct sortctx *ctx,
+		  char		*a,
+		  size_t	n
+		)
+{
+    size_t es, start, root, child;
+
+    es = ctx->es;
+
+    /* Build a max-heap, then move its top to the end repeatedly */
+    start = n / 2;
+    while (n > 1)
     {
-        if (i < lp)
+        if (start > 0)
+        {
+            start--;
+        }
+        else
+        {
+            n--;
+            qsswap(ctx, a, a + n * es);
+        }
+        for (root = start; (child = 2 * root + 1) < n; root = child)
         {
-            if ((c = (*qscmp) (i, lp)) == 0)
+            if (child + 1 < n && ctx->cmp(a + child * es,
+                                          a + (child + 1) * es,
+                                          ctx->arg) < 0)
             {
-                qsexc(i, lp -= es);
-                continue;
+                child++;
             }
-            if (c < 0)
+            if (ctx->cmp(a + root * es, a + child * es, ctx->arg) >= 0)
             {
-                i += es;
-                continue;
+                break;
             }
+            qsswap(ctx, a + root * es, a + child * es);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------
+ *  qsintro  -  Partition around a median-of-3 pivot, recursing into
+ *		the smaller side and looping on the larger one
+ *------------------------------------------------------------------------
+ */
+static void	qsintro(
+		  struct sortctx *ctx,
+		  char		*a,
+		  size_t	n,
+		  int		depth
+		)
+{
+    char *lo, *mid, *hi;
+    char *i, *j;
+    size_t es, nl, nr;
+
+    es = ctx->es;
+    while (n > QSCUTOFF)
+    {
+        if (depth-- == 0)
+        {
+            qsheap(ctx, a, n);
+            return;
         }
 
-      loop:
-        if (j > hp)
+        /* Order the first, middle and last elements; the median */
+        /*   becomes the pivot at a[0]                           */
+        lo = a;
+        mid = a + (n / 2) * es;
+        hi = a + (n - 1) * es;
+        if (ctx->cmp(mid, lo, ctx->arg) < 0)
         {
-            if ((c = (*qscmp) (hp, j)) == 0)
-            {
-                qsexc(hp += es, j);
-                goto loop;
-            }
-            if (c > 0)
+            qsswap(ctx, mid, lo);
+        }
+        if (ctx->cmp(hi, mid, ctx->arg) < 0)
+        {
+            qsswap(ctx, hi, mid);
+            if (ctx->cmp(mid, lo, ctx->arg) < 0)
             {
-                if (i == lp)
-                {
-                    qstexc(i, hp += es, j);
-                    i = lp += es;
-                    goto loop;
-                }
-                qsexc(i, j);
-                j -= es;
-                i += es;
-                continue;
+                qsswap(ctx, mid, lo);
             }
-            j -= es;
-            goto loop;
         }
+        qsswap(ctx, a, mid);
 
-        if (i == lp)
+        /* Both scans stop on keys equal to the pivot, so runs of */
+        /*   equal keys still split evenly                        */
+        i = a + es;
+        j = hi;
+        for (;;)
         {
-            if (lp - a >= l - hp)
+            while (i <= j && ctx->cmp(i, a, ctx->arg) < 0)
             {
-                qs1(hp + es, l);
-                l = lp;
+                i += es;
             }
-            else
+            while (i <= j && ctx->cmp(j, a, ctx->arg) > 0)
+            {
+                j -= es;
+            }
+            if (i >= j)
             {
-                qs1(a, lp);
-                a = hp + es;
+                break;
             }
-            goto start;
+            qsswap(ctx, i, j);
+            i += es;
+            j -= es;
         }
+        qsswap(ctx, a, j);
 
-        qstexc(j, lp -= es, i);
-        j = hp -= es;
+        nl = (j - a) / es;
+        nr = n - nl - 1;
+        if (nl < nr)
+        {
+            qsintro(ctx, a, nl, depth);
+            a = j + es;
+            n = nr;
+        }
+        else
+        {
+            qsintro(ctx, j + es, nr, depth);
+            n = nl;
+        }
     }
+    qsinsert(ctx, a, n);
 }
 
 /*------------------------------------------------------------------------
- *  qsexc  -  internal quicksort function
+ *  msreverse  -  Reverse elements lo through hi-1
  *------------------------------------------------------------------------
  */
-static void	qsexc(
-		  char		*i,
-		  char		*j
+static void	msreverse(
+		  struct sortctx *ctx,
+		  size_t	lo,
+		  size_t	hi
 		)
 {
-    register char *ri, *rj, c;
-    int n;
-
-    n = qses;
-    ri = i;
-    rj = j;
-    do
+    while (lo + 1 < hi)
     {
-        c = *ri;
-        *ri++ = *rj;
-        *rj++ = c;
+        hi--;
+        qsswap(ctx, ctx->base + lo * ctx->es, ctx->base + hi * ctx->es);
+        lo++;
     }
-    while (--n);
 }
 
 /*------------------------------------------------------------------------
- *  qstexc  -  internal quicksort function
+ *  msmerge  -  Merge sorted runs [lo,m) and [m,hi) in place, keeping
+ *		equal elements in order (SymMerge, Kim and Kutzner 2004)
  *------------------------------------------------------------------------
  */
-static void	qstexc(
-		  char		*i,
-		  char		*j,
-		  char		*k
+static void	msmerge(
+		  struct sortctx *ctx,
+		  size_t	lo,
+		  size_t	m,
+		  size_t	hi
 		)
 {
-    register char *ri, *rj, *rk;
-    int c;
-    int n;
-
-    n = qses;
-    ri = i;
-    rj = j;
-    rk = k;
-    do
-    {
-        c = *ri;
-        *ri++ = *rk;
-        *rk++ = *rj;
-        *rj++ = c;
-    }
-    while (--n);
+    char *base;
+    size_t es, mid, start, end, r, c, i, j, h, sum;
+
+    base = ctx->base;
+    es = ctx->es;
+
+    /* A run of one element is binary inserted into the other */
+    if (m - lo == 1)
+    {
+        i = m;
+        j = hi;
+        while (i < j)
+        {
+            h = (i + j) / 2;
+            if (ctx->cmp(base + h * es, base + lo * es, ctx->arg) < 0)
+            {
+                i = h + 1;
+            }
+            else
+            {
+                j = h;
+            }
+        }
+        for (h = lo; h + 1 < i; h++)
+        {
+            qsswap(ctx, base + h * es, base + (h + 1) * es);
+        }
+        return;
+    }
+    if (hi - m == 1)
+    {
+        i = lo;
+        j = m;
+        while (i < j)
+        {
+            h = (i + j) / 2;
+            if (ctx->cmp(base + m * es, base + h * es, ctx->arg) >= 0)
+            {
+                i = h + 1;
+            }
+            else
+            {
+                j = h;
+            }
+        }
+        for (h = m; h > i; h--)
+        {
+            qsswap(ctx, base + h * es, base + (h - 1) * es);
+        }
+        return;
+    }
+
+    /* Find where to cut both runs so that rotating the middle puts */
+    /*   every element of the left pieces before the right pieces   */
+    mid = lo + (hi - lo) / 2;
+    sum = mid + m;
+    if (m > mid)
+    {
+        start = sum - hi;
+        r = mid;
+    }
+    else
+    {
+        start = lo;
+        r = m;
+    }
+    while (start < r)
+    {
+        c = start + (r - start) / 2;
+        if (ctx->cmp(base + (sum - 1 - c) * es, base + c * es,
+                     ctx->arg) >= 0)
+        {
+            start = c + 1;
+        }
+        else
+        {
+            r = c;
+        }
+    }
+    end = sum - start;
+    if (start < m && m < end)
+    {
+        msreverse(ctx, start, m);
+        msreverse(ctx, m, end);
+        msreverse(ctx, start, end);
+    }
+    if (lo < start && start < mid)
+    {
+        msmerge(ctx, lo, start, mid);
+    }
+    if (mid < end && end < hi)
+    {
+        msmerge(ctx, mid, end, hi);
+    }
 }
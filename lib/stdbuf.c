@@ -0,0 +1,149 @@
+/* stdbuf.c - bufputc, fflush, setvbuf, bufdone */
+
+#include <xinu.h>
+#include <syscall.h>
+
+/* Each process buffers what it writes to its stdout descriptor, so a	*/
+/*   line (or a buffer, for a device that is not a tty) costs one	*/
+/*   XINU_PUTS write instead of a system call per character		*/
+
+local	struct	stdbuf	{
+	char	*sbuf;			/* Buffer, or NULL until used	*/
+	int32	slen;			/* Bytes waiting in the buffer	*/
+	int32	ssize;			/* Size of the buffer		*/
+	int32	smode;			/* _IOFBF, _IOLBF, _IONBF or 0	*/
+					/*   if not chosen yet		*/
+	bool8	sown;			/* Buffer came from getmem	*/
+} stdbufs[NPROC];
+
+/*------------------------------------------------------------------------
+ *  bufsetup  -  Choose the default mode and get a buffer the first time
+ *		   a process writes to its stdout
+ *------------------------------------------------------------------------
+ */
+local	status	bufsetup(
+	  struct stdbuf	*sp,		/* Buffer state of the process	*/
+	  int		dev		/* Its stdout descriptor	*/
+	)
+{
+	if (sp->smode == 0) {
+		if (isbaddev(dev)) {
+			return SYSERR;
+		}
+		sp->smode = (devtab[dev].dvputc == ttyputc) ? _IOLBF : _IOFBF;
+	}
+	if (sp->smode == _IONBF) {
+		return SYSERR;
+	}
+	if (sp->ssize == 0) {
+		sp->ssize = BUFSIZ;
+	}
+	if ((sp->sbuf = getmem(sp->ssize)) == (char *)SYSERR) {
+		sp->sbuf = NULL;
+		return SYSERR;
+	}
+	sp->sown = TRUE;
+	sp->slen = 0;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  bufputc  -  Write a character for printf, fprintf, fputc and fputs,
+ *		  buffering it if it goes to the caller's stdout
+ *------------------------------------------------------------------------
+ */
+int	bufputc(
+	  int		dev,		/* Device to write to		*/
+	  int		c		/* Character to write		*/
+	)
+{
+	struct	stdbuf	*sp;		/* Buffer state of the caller	*/
+
+	if (dev != stdout) {
+		fflush(stdout);		/* Keep output in order		*/
+		return putc(dev, c);
+	}
+	sp = &stdbufs[currpid];
+	if (sp->sbuf == NULL && bufsetup(sp, dev) == SYSERR) {
+		return putc(dev, c);
+	}
+	sp->sbuf[sp->slen++] = c;
+	if (sp->slen >= sp->ssize || (c == '\n' && sp->smode == _IOLBF)) {
+		fflush(dev);
+	}
+	return c;
+}
+
+/*------------------------------------------------------------------------
+ *  fflush  -  Write out what the caller has buffered for a device
+ *------------------------------------------------------------------------
+ */
+int	fflush(
+	  int		dev		/* Device to flush		*/
+	)
+{
+	struct	stdbuf	*sp;		/* Buffer state of the caller	*/
+	int32	len;			/* Bytes to write		*/
+
+	sp = &stdbufs[currpid];
+	if (dev != stdout || sp->slen == 0) {
+		return 0;
+	}
+	len = sp->slen;
+	sp->slen = 0;
+	syscallp.puts(dev, sp->sbuf, len);
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ *  setvbuf  -  Set how the caller's stdout is buffered; a NULL buffer
+ *		  means one of the given size is allocated when needed
+ *------------------------------------------------------------------------
+ */
+int	setvbuf(
+	  int		dev,		/* Must be the caller's stdout	*/
+	  char		*buf,		/* Buffer to use, or NULL	*/
+	  int		mode,		/* _IOFBF, _IOLBF or _IONBF	*/
+	  int		size		/* Size of the buffer		*/
+	)
+{
+	struct	stdbuf	*sp;		/* Buffer state of the caller	*/
+
+	if (dev != stdout || (mode != _IOFBF && mode != _IOLBF
+	    && mode != _IONBF) || (mode != _IONBF && size <= 0)) {
+		return SYSERR;
+	}
+	fflush(dev);
+	sp = &stdbufs[currpid];
+	if (sp->sown) {
+		freemem(sp->sbuf, sp->ssize);
+	}
+	sp->smode = mode;
+	sp->sbuf = (mode == _IONBF) ? NULL : buf;
+	sp->ssize = (mode == _IONBF) ? 0 : size;
+	sp->sown = FALSE;
+	sp->slen = 0;
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ *  bufdone  -  Release the stdout buffer of a process being killed
+ *		  (kill flushes it first when a process exits itself)
+ *------------------------------------------------------------------------
+ */
+void	bufdone(
+	  pid32		pid		/* ID of process being killed	*/
+	)
+{
+	struct	stdbuf	*sp;		/* Buffer state of the process	*/
+
+	sp = &stdbufs[pid];
+	if (sp->sown) {
+		freemem(sp->sbuf, sp->ssize);
+	}
+	sp->sbuf = NULL;
+	sp->slen = 0;
+	sp->ssize = 0;
+	sp->smode = 0;
+	sp->sown = FALSE;
+}
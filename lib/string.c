@@ -26,14 +26,50 @@
 
 //#include <kernel/fault.h>
 
+/*
+ * The block functions below move a word at a time once the destination
+ * is aligned, and 32 bytes per loop iteration in the bulk of a copy, so
+ * the compiler can use LDM/STM.  When source and destination are not
+ * aligned alike, memcpy reads aligned source words and shifts adjacent
+ * pairs together (little-endian).  Such reads stay inside the aligned
+ * words that hold the source bytes.
+ */
+
+#define WSIZE       sizeof(uint32_t)
+#define WMASK       (WSIZE - 1)
+#define ONES        0x01010101UL
+#define HIGHS       0x80808080UL
+
+/* Nonzero if any byte of the word is zero */
+#define haszero(w)  (((w) - ONES) & ~(w) & HIGHS)
+
 void *memchr(const void *ptr, int value, size_t num) {
     const unsigned char *p = ptr;
+    const uint32_t *w;
+    uint32_t pattern, x;
+    unsigned char c = (unsigned char) value;
 
-    while (num--) {
-        if (*p == value) {
+    while (num && ((uintptr_t) p & WMASK)) {
+        if (*p == c) {
             return (void *) p;
         }
         p++;
+        num--;
+    }
+
+    /* Skip words that cannot hold c */
+    pattern = c * ONES;
+    for (w = (const uint32_t *) p; num >= WSIZE; w++, num -= WSIZE) {
+        x = *w ^ pattern;
+        if (haszero(x)) {
+            break;
+        }
+    }
+
+    for (p = (const unsigned char *) w; num--; p++) {
+        if (*p == c) {
+            return (void *) p;
+        }
     }
 
     return NULL;
@@ -43,7 +79,25 @@ int memcmp(const void *ptr1, const void *ptr2, int num) {
     const unsigned char *p1 = ptr1;
     const unsigned char *p2 = ptr2;
 
-    while (num--) {
+    /* Skip equal words when both pointers can be aligned together */
+    if ((((uintptr_t) p1 ^ (uintptr_t) p2) & WMASK) == 0) {
+        while (num > 0 && ((uintptr_t) p1 & WMASK)) {
+            if (*p1 != *p2) {
+                return *p1 > *p2 ? 1 : -1;
+            }
+            p1++;
+            p2++;
+            num--;
+        }
+        while (num >= (int) WSIZE
+               && *(const uint32_t *) p1 == *(const uint32_t *) p2) {
+            p1 += WSIZE;
+            p2 += WSIZE;
+            num -= WSIZE;
+        }
+    }
+
+    while (num-- > 0) {
         if (*p1 != *p2) {
             if (*p1 > *p2) {
                 return 1;
@@ -60,29 +114,97 @@ int memcmp(const void *ptr1, const void *ptr2, int num) {
     return 0;
 }
 
- 
 void memset(void *p, uint8_t value, uint32_t size) {
-    uint8_t *end = (uint8_t *) ((uintptr_t) p + size);
+    uint8_t *d = p;
+    uint32_t *w;
+    uint32_t fill;
 
-    while ( (uint8_t*) p < end ) {
-        *((uint8_t*)p) = value;
-        p++;
+    while (size && ((uintptr_t) d & WMASK)) {
+        *d++ = value;
+        size--;
     }
-}
 
+    fill = value * ONES;
+    w = (uint32_t *) d;
+    for (; size >= 32; size -= 32, w += 8) {
+        w[0] = fill; w[1] = fill; w[2] = fill; w[3] = fill;
+        w[4] = fill; w[5] = fill; w[6] = fill; w[7] = fill;
+    }
+    for (; size >= WSIZE; size -= WSIZE) {
+        *w++ = fill;
+    }
+
+    d = (uint8_t *) w;
+    while (size--) {
+        *d++ = value;
+    }
+}
 
+/*
+ * Copy ascending, always reading a source byte before writing any
+ * destination byte at or above it, which memmove relies on.
+ */
 void    *memcpy(
       void      *s, /* Destination address          */
       const void    *ct,    /* source address           */
       int       n   /* number of bytes to copy      */
     )
 {
-    register int i;
-    char *dst = (char *)s;
-    char *src = (char *)ct;
+    uint8_t *dst = (uint8_t *)s;
+    const uint8_t *src = (const uint8_t *)ct;
+    uint32_t *wd;
+    const uint32_t *ws;
+    uint32_t a, b, c, d, e, f, g, h;
+    uint32_t prev, next;
+    int lsh, rsh;
+
+    if (n <= 0) {
+        return s;
+    }
 
-    for (i = 0; i < n; i++)
-    {
+    /* Short copies are not worth setting up */
+    if (n < 16) {
+        while (n--) {
+            *dst++ = *src++;
+        }
+        return s;
+    }
+
+    while ((uintptr_t) dst & WMASK) {
+        *dst++ = *src++;
+        n--;
+    }
+    wd = (uint32_t *) dst;
+
+    if (((uintptr_t) src & WMASK) == 0) {
+        ws = (const uint32_t *) src;
+        for (; n >= 32; n -= 32, ws += 8, wd += 8) {
+            a = ws[0]; b = ws[1]; c = ws[2]; d = ws[3];
+            e = ws[4]; f = ws[5]; g = ws[6]; h = ws[7];
+            wd[0] = a; wd[1] = b; wd[2] = c; wd[3] = d;
+            wd[4] = e; wd[5] = f; wd[6] = g; wd[7] = h;
+        }
+        for (; n >= (int) WSIZE; n -= WSIZE) {
+            *wd++ = *ws++;
+        }
+        src = (const uint8_t *) ws;
+    }
+    else {
+        /* Merge each pair of aligned source words into one word */
+        lsh = ((uintptr_t) src & WMASK) * 8;
+        rsh = 32 - lsh;
+        ws = (const uint32_t *) ((uintptr_t) src & ~WMASK);
+        prev = *ws++;
+        for (; n >= (int) WSIZE; n -= WSIZE) {
+            next = *ws++;
+            *wd++ = (prev >> lsh) | (next << rsh);
+            prev = next;
+        }
+        src = (const uint8_t *) ws - WSIZE + lsh / 8;
+    }
+
+    dst = (uint8_t *) wd;
+    while (n--) {
         *dst++ = *src++;
     }
     return s;
@@ -90,12 +212,32 @@ void    *memcpy(
 
 // Overlap-safe memcpy
 void memmove(void *dst, const void *src, size_t n) {
-    const char *s = src;
-    char *d = dst;
-    if ((uintptr_t)s < (uintptr_t)d)
-        while(n--) d[n] = s[n];
-    else
-        while(n--) *d++ = *s++;
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+
+    /* An ascending copy is safe unless d lies inside the source */
+    if ((uintptr_t) d <= (uintptr_t) s || (uintptr_t) d >= (uintptr_t) s + n) {
+        memcpy(d, s, n);
+        return;
+    }
+
+    /* Copy descending, by words when the ends align alike */
+    s += n;
+    d += n;
+    if ((((uintptr_t) s ^ (uintptr_t) d) & WMASK) == 0) {
+        while (n && ((uintptr_t) d & WMASK)) {
+            *--d = *--s;
+            n--;
+        }
+        for (; n >= WSIZE; n -= WSIZE) {
+            d -= WSIZE;
+            s -= WSIZE;
+            *(uint32_t *) d = *(const uint32_t *) s;
+        }
+    }
+    while (n--) {
+        *--d = *--s;
+    }
 }
 
 char *strchr(const char *s, int c) {
@@ -111,11 +253,23 @@ char *strchr(const char *s, int c) {
 }
 
 int strlen(const char *s) {
-    int len = 0;
-    while (*s++) {
-        len++;
+    const char *p = s;
+    const uint32_t *w;
+
+    while ((uintptr_t) p & WMASK) {
+        if (*p == '\0') {
+            return p - s;
+        }
+        p++;
     }
-    return len;
+
+    /* Aligned words never cross into memory the string does not reach */
+    for (w = (const uint32_t *) p; !haszero(*w); w++)
+        ;
+
+    for (p = (const char *) w; *p; p++)
+        ;
+    return p - s;
 }
 
  
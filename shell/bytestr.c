@@ -0,0 +1,138 @@
+/* bytestr.c - bytecpy, byteset, bytemove, bytecmp, bytechr, bytelen */
+
+#include <xinu.h>
+
+/* The byte-at-a-time loops lib/string.c had before it moved a word at	*/
+/*   a time, kept with the same bodies so that "bench string" and the	*/
+/*   host harness in test/ measure the new code against the old one.	*/
+/*   GCC would turn the copy and fill loops into calls to the new	*/
+/*   memcpy and memset at higher optimization levels, so that is off.	*/
+
+#pragma GCC optimize ("no-tree-loop-distribute-patterns")
+
+/*------------------------------------------------------------------------
+ *  bytecpy  -  Copy n bytes, one per iteration (the old memcpy)
+ *------------------------------------------------------------------------
+ */
+void	*bytecpy(
+	  void		*s,		/* Destination address		*/
+	  const void	*ct,		/* Source address		*/
+	  int32		n		/* Number of bytes to copy	*/
+	)
+{
+	register int i;
+	char	*dst = (char *)s;
+	char	*src = (char *)ct;
+
+	for (i = 0; i < n; i++) {
+		*dst++ = *src++;
+	}
+	return s;
+}
+
+/*------------------------------------------------------------------------
+ *  byteset  -  Fill size bytes with a value (the old memset)
+ *------------------------------------------------------------------------
+ */
+void	byteset(
+	  void		*p,		/* Address to fill		*/
+	  uint8		value,		/* Value to store		*/
+	  uint32	size		/* Number of bytes to fill	*/
+	)
+{
+	uint8	*end = (uint8 *)((uint32)p + size);
+
+	while ((uint8 *)p < end) {
+		*((uint8 *)p) = value;
+		p++;
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  bytemove  -  Copy n bytes that may overlap (the old memmove)
+ *------------------------------------------------------------------------
+ */
+void	bytemove(
+	  void		*dst,		/* Destination address		*/
+	  const void	*src,		/* Source address		*/
+	  uint32	n		/* Number of bytes to copy	*/
+	)
+{
+	const	char	*s = src;
+	char	*d = dst;
+
+	if ((uint32)s < (uint32)d) {
+		while (n--) {
+			d[n] = s[n];
+		}
+	} else {
+		while (n--) {
+			*d++ = *s++;
+		}
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  bytecmp  -  Compare num bytes (the old memcmp)
+ *------------------------------------------------------------------------
+ */
+int32	bytecmp(
+	  const void	*ptr1,		/* First block			*/
+	  const void	*ptr2,		/* Second block			*/
+	  int32		num		/* Number of bytes to compare	*/
+	)
+{
+	const	unsigned char *p1 = ptr1;
+	const	unsigned char *p2 = ptr2;
+
+	while (num--) {
+		if (*p1 != *p2) {
+			if (*p1 > *p2) {
+				return 1;
+			} else {
+				return -1;
+			}
+		}
+		p1++;
+		p2++;
+	}
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ *  bytechr  -  Find a byte in the first num bytes (the old memchr)
+ *------------------------------------------------------------------------
+ */
+void	*bytechr(
+	  const void	*ptr,		/* Block to search		*/
+	  int32		value,		/* Byte to find			*/
+	  uint32	num		/* Number of bytes to search	*/
+	)
+{
+	const	unsigned char *p = ptr;
+
+	while (num--) {
+		if (*p == value) {
+			return (void *)p;
+		}
+		p++;
+	}
+	return NULL;
+}
+
+/*------------------------------------------------------------------------
+ *  bytelen  -  Length of a string, one byte per iteration (the old
+ *		  strlen)
+ *------------------------------------------------------------------------
+ */
+int32	bytelen(
+	  const char	*s		/* String to measure		*/
+	)
+{
+	int32	len = 0;
+
+	while (*s++) {
+		len++;
+	}
+	return len;
+}
@@ -61,6 +61,7 @@ const	struct	cmdent	cmdtab[] = {
 	{"cat",     FALSE,  xsh_cat},
 	{"dump",    FALSE,  xsh_dump},
 	{"mkdir",   TRUE,   xsh_mkdir},
+	{"df",      TRUE,   xsh_df},
 	{"pwd",     TRUE,   xsh_pwd},
 	{"rm",      TRUE,   xsh_rm},
 	{"touch",   TRUE,   xsh_touch},
@@ -69,6 +70,7 @@ const	struct	cmdent	cmdtab[] = {
 	{"test",    FALSE,  xsh_test},
 	//{"loadkernel",    FALSE,  xsh_loadkernel},
 	{"cpu",    FALSE,  xsh_cpu},
+	{"bench",  FALSE,  xsh_bench},
 	{"interp",FALSE,tinyscript},
 	{"cc",FALSE,cc},
 	//{"basic",FALSE,basic},
@@ -0,0 +1,856 @@
+/* xsh_bench.c - xsh_bench */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+#include <fat_filelib.h>
+
+extern	uint32_t SystemCoreClock;
+
+local	void	bench_ctxsw(int32);
+local	void	bench_timer(int32);
+local	void	bench_port(int32);
+local	void	bench_heap(int32);
+local	void	bench_append(int32);
+local	void	bench_string(int32);
+local	void	bench_printf(int32);
+local	void	bench_fat(int32);
+local	void	bench_fopen(int32);
+
+/* Table of benchmarks that can be selected from the command line	*/
+
+local	const	struct	{
+	char	*bname;			/* Name of benchmark		*/
+	void	(*bfunc)(int32);	/* Function that runs it	*/
+	char	*bhelp;			/* One line description		*/
+} benchtab[] = {
+	{"ctxsw",	bench_ctxsw,	"context switch time vs ready processes"},
+	{"timer",	bench_timer,	"timing wheel insert/cancel vs sleepers"},
+	{"port",	bench_port,	"port messages per second vs port depth"},
+	{"heap",	bench_heap,	"getmem/freemem latency and fragmentation"},
+	{"append",	bench_append,	"realloc cost of growing a buffer"},
+	{"string",	bench_string,	"memcpy/memset/strlen MB/s vs byte loops"},
+	{"printf",	bench_printf,	"sprintf cost per conversion and per line"},
+	{"fat",		bench_fat,	"FAT file write and open/seek with cache counters"},
+	{"fopen",	bench_fopen,	"fopen on a deep path and in a large directory"},
+};
+
+#define	NBENCH	(sizeof(benchtab) / sizeof(benchtab[0]))
+
+/*------------------------------------------------------------------------
+ * xsh_bench - run one of the kernel micro benchmarks
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_bench(int nargs, char *args[])
+{
+	int32	i;			/* Index into benchtab		*/
+	int32	arg;			/* Optional numeric argument	*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Usage: %s NAME [N]\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tRuns a kernel benchmark and prints the result\n");
+		printf("Benchmarks:\n");
+		for (i = 0; i < NBENCH; i++) {
+			printf("\t%-8s %s\n", benchtab[i].bname,
+				benchtab[i].bhelp);
+		}
+		printf("Options:\n");
+		printf("\tN\tlargest problem size to measure\n");
+		printf("\t--help\tdisplay this help and exit\n");
+		return 0;
+	}
+
+	if (nargs < 2 || nargs > 3) {
+		fprintf(stderr, "%s: incorrect argument\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+			args[0]);
+		return 1;
+	}
+
+	arg = (nargs == 3) ? atoi(args[2]) : 0;
+	for (i = 0; i < NBENCH; i++) {
+		if (strcmp(args[1], benchtab[i].bname) == 0) {
+			benchtab[i].bfunc(arg);
+			return 0;
+		}
+	}
+	fprintf(stderr, "%s: no benchmark named %s\n", args[0], args[1]);
+	return 1;
+}
+
+/*------------------------------------------------------------------------
+ * cyc2ns - Convert a DWT cycle count to nanoseconds
+ *------------------------------------------------------------------------
+ */
+local	uint32	cyc2ns(
+	  uint32	cycles		/* Cycles counted by DWT	*/
+	)
+{
+	return (uint32)(((uint64)cycles * 1000000000) / SystemCoreClock);
+}
+
+/*------------------------------------------------------------------------
+ * bench_ctxsw - Measure the cost of a yield-driven context switch as
+ *		  the number of ready processes grows
+ *------------------------------------------------------------------------
+ */
+#define	CTXSW_ROUNDS	2000		/* Yields done by the benchmark	*/
+#define	CTXSW_STK	512		/* Stack size of a spinner	*/
+
+local	volatile bool8	spinstop;	/* Tells spinners to exit	*/
+
+local	process	spinner(void)
+{
+	while (!spinstop) {
+		yield();
+	}
+	return OK;
+}
+
+local	void	bench_ctxsw(
+	  int32		maxn		/* Most spinners to create	*/
+	)
+{
+	int32	n;			/* Spinners in this round	*/
+	int32	i;			/* Counts spinners and yields	*/
+	int32	nspin;			/* Spinners actually created	*/
+	pid32	spins[NPROC];		/* IDs of the spinners		*/
+	pri16	prio;			/* Priority of this process	*/
+	uint32	start, cycles;		/* DWT cycle counter samples	*/
+	uint32	nsw;			/* Context switches measured	*/
+
+	if (maxn <= 0 || maxn > NPROC - prcount) {
+		maxn = NPROC - prcount;
+	}
+	prio = getprio(getpid());
+
+	printf("%5s %10s %10s\n", "Ready", "Cycles/sw", "ns/sw");
+	printf("%5s %10s %10s\n", "-----", "----------", "----------");
+
+	for (n = 1; n <= maxn; n++) {
+
+		/* Spinners share our priority, so each yield rotates	*/
+		/*   through all of them before we run again		*/
+
+		spinstop = FALSE;
+		for (nspin = 0; nspin < n; nspin++) {
+			spins[nspin] = create(spinner, CTXSW_STK, prio,
+						"spinner", 0);
+			if (spins[nspin] == SYSERR) {
+				break;
+			}
+			resume(spins[nspin]);
+		}
+		if (nspin != n) {
+			printf("cannot create %d spinners\n", n);
+			n = maxn;
+		} else {
+			start = DWT->CYCCNT;
+			for (i = 0; i < CTXSW_ROUNDS; i++) {
+				yield();
+			}
+			cycles = DWT->CYCCNT - start;
+			nsw = CTXSW_ROUNDS * (n + 1);
+			printf("%5d %10d %10d\n", n + 1, cycles / nsw,
+				cyc2ns(cycles / nsw));
+		}
+
+		spinstop = TRUE;
+		for (i = 0; i < nspin; i++) {
+			while (proctab[spins[i]].prstate != PR_FREE) {
+				yield();
+			}
+		}
+		recvclr();		/* Discard child exit messages	*/
+	}
+}
+
+/*------------------------------------------------------------------------
+ * bench_timer - Measure timing wheel insert and cancel cost as the
+ *		  number of pending sleepers grows
+ *------------------------------------------------------------------------
+ */
+#define	TIMER_MAXN	256		/* Most nodes that can be timed	*/
+
+local	struct	tmnode	bnodes[TIMER_MAXN]; /* Nodes used by the bench	*/
+
+local	void	bench_timer(
+	  int32		maxn		/* Most sleepers to schedule	*/
+	)
+{
+	int32	n;			/* Sleepers in this round	*/
+	int32	i;			/* Index into bnodes		*/
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint32	start;			/* DWT cycle counter sample	*/
+	uint32	tins, tcan;		/* Cycles to insert and cancel	*/
+
+	if (maxn <= 0 || maxn > TIMER_MAXN) {
+		maxn = TIMER_MAXN;
+	}
+
+	printf("%8s %12s %12s\n", "Sleepers", "Insert cyc", "Cancel cyc");
+	printf("%8s %12s %12s\n", "--------", "------------",
+		"------------");
+
+	for (n = 1; n <= maxn; n *= 2) {
+
+		/* Nodes are never due while interrupts are off, so	*/
+		/*   none of them can expire during the measurement	*/
+
+		mask = disable();
+		start = DWT->CYCCNT;
+		for (i = 0; i < n; i++) {
+			tminsert(&bnodes[i], 1 + (i * 7919) % 60000);
+		}
+		tins = DWT->CYCCNT - start;
+
+		start = DWT->CYCCNT;
+		for (i = 0; i < n; i++) {
+			tmremove(&bnodes[i]);
+		}
+		tcan = DWT->CYCCNT - start;
+		restore(mask);
+
+		printf("%8d %12d %12d\n", n, tins / n, tcan / n);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * bench_port - Measure message throughput through a port between two
+ *		 processes of equal priority as the port depth grows
+ *------------------------------------------------------------------------
+ */
+#define	PORT_MSGS	10000		/* Default messages per round	*/
+#define	PORT_STK	512		/* Stack size of the receiver	*/
+
+local	volatile uint32	portend;	/* Cycle count at last receive	*/
+
+local	process	portsink(
+	  int32		port,		/* Port to drain		*/
+	  int32		nmsgs		/* Messages to receive		*/
+	)
+{
+	while (nmsgs-- > 0) {
+		ptrecv(port);
+	}
+	portend = DWT->CYCCNT;
+	return OK;
+}
+
+local	void	bench_port(
+	  int32		nmsgs		/* Messages sent in each round	*/
+	)
+{
+	int32	depth;			/* Port depth in this round	*/
+	int32	port;			/* Port being measured		*/
+	int32	i;			/* Counts messages		*/
+	pid32	sink;			/* Receiving process		*/
+	uint32	start, cycles;		/* DWT cycle counter samples	*/
+
+	if (nmsgs <= 0) {
+		nmsgs = PORT_MSGS;
+	}
+
+	printf("%5s %10s %10s\n", "Depth", "Cycles/msg", "Msgs/sec");
+	printf("%5s %10s %10s\n", "-----", "----------", "----------");
+
+	for (depth = 1; depth <= PT_MSGS; depth *= 4) {
+		if ((port = ptcreate(depth)) == SYSERR) {
+			printf("cannot create a port of depth %d\n", depth);
+			break;
+		}
+		sink = create(portsink, PORT_STK, getprio(getpid()),
+				"portsink", 2, port, nmsgs);
+		if (sink == SYSERR) {
+			printf("cannot create the receiver\n");
+			ptdelete(port, NULL);
+			break;
+		}
+
+		/* The sender fills the port and blocks, then the receiver	*/
+		/*   drains it, so each switch moves up to depth messages	*/
+
+		resume(sink);
+		start = DWT->CYCCNT;
+		for (i = 0; i < nmsgs; i++) {
+			ptsend(port, i);
+		}
+		while (proctab[sink].prstate != PR_FREE) {
+			yield();
+		}
+		cycles = portend - start;
+		recvclr();		/* Discard child exit message	*/
+		ptdelete(port, NULL);
+
+		printf("%5d %10d %10d\n", depth, cycles / nmsgs,
+			(uint32)((uint64)nmsgs * SystemCoreClock / cycles));
+	}
+}
+
+/*------------------------------------------------------------------------
+ * bench_heap - Replay a pseudo-random allocation trace against getmem
+ *		 and freemem, reporting latency percentiles and how
+ *		 fragmented the heap is left
+ *------------------------------------------------------------------------
+ */
+#define	HEAP_OPS	1000		/* Default operations replayed	*/
+#define	HEAP_LIVE	48		/* Most blocks held at once	*/
+#define	HEAP_SAMPLES	512		/* Latencies kept per operation	*/
+
+local	char	*hlive[HEAP_LIVE];	/* Blocks the trace holds	*/
+local	uint32	hsize[HEAP_LIVE];	/* Sizes of those blocks	*/
+local	uint16	hget[HEAP_SAMPLES];	/* getmem latencies in cycles	*/
+local	uint16	hput[HEAP_SAMPLES];	/* freemem latencies in cycles	*/
+
+/*------------------------------------------------------------------------
+ * hsort - Sort latency samples in ascending order (insertion sort)
+ *------------------------------------------------------------------------
+ */
+local	void	hsort(
+	  uint16	*v,		/* Samples to sort		*/
+	  int32		n		/* Number of samples		*/
+	)
+{
+	int32	i, j;			/* Index the samples		*/
+	uint16	t;			/* Sample being placed		*/
+
+	for (i = 1; i < n; i++) {
+		t = v[i];
+		for (j = i; j > 0 && v[j - 1] > t; j--) {
+			v[j] = v[j - 1];
+		}
+		v[j] = t;
+	}
+}
+
+/*------------------------------------------------------------------------
+ * hprint - Print the percentiles of one operation's latencies
+ *------------------------------------------------------------------------
+ */
+local	void	hprint(
+	  char		*name,		/* Operation measured		*/
+	  uint16	*v,		/* Its latency samples		*/
+	  int32		n		/* Number of samples		*/
+	)
+{
+	if (n == 0) {
+		printf("%-8s %7s\n", name, "-");
+		return;
+	}
+	hsort(v, n);
+	printf("%-8s %7d %7d %7d %7d %7d\n", name, n, v[n / 2],
+		v[n * 9 / 10], v[n * 99 / 100], v[n - 1]);
+}
+
+local	void	bench_heap(
+	  int32		nops		/* Operations in the trace	*/
+	)
+{
+	int32	i;			/* Counts operations		*/
+	int32	k;			/* Slot the operation uses	*/
+	int32	nget, nput;		/* Latencies recorded		*/
+	int32	nfail;			/* Allocations that failed	*/
+	uint32	seed;			/* State of the trace generator	*/
+	uint32	r;			/* Random value for this step	*/
+	uint32	size;			/* Size of an allocation	*/
+	struct	memstat	ms;		/* Heap state after the trace	*/
+	uint32	start, cycles;		/* DWT cycle counter samples	*/
+	intmask	mask;			/* Saved interrupt mask		*/
+	char	*p;			/* Block returned by getmem	*/
+
+	if (nops <= 0) {
+		nops = HEAP_OPS;
+	}
+	for (k = 0; k < HEAP_LIVE; k++) {
+		hlive[k] = NULL;
+	}
+
+	/* The trace is fixed by the seed, so runs on different	*/
+	/*   allocators see the same requests in the same order	*/
+
+	seed = 12345;
+	nget = nput = nfail = 0;
+	for (i = 0; i < nops; i++) {
+		seed = seed * 1103515245 + 12345;
+		r = seed >> 8;
+		k = r % HEAP_LIVE;
+		if (hlive[k] != NULL) {
+			mask = disable();
+			start = DWT->CYCCNT;
+			freemem(hlive[k], hsize[k]);
+			cycles = DWT->CYCCNT - start;
+			restore(mask);
+			hlive[k] = NULL;
+			if (nput < HEAP_SAMPLES) {
+				hput[nput++] = cycles > 0xFFFF ? 0xFFFF : cycles;
+			}
+			continue;
+		}
+
+		/* Mostly small blocks, some buffers, a few large ones	*/
+
+		r >>= 6;
+		if (r % 20 == 0) {
+			size = 1024 + (r >> 5) % 3072;
+		} else if (r % 5 == 0) {
+			size = 128 + (r >> 5) % 896;
+		} else {
+			size = 8 + (r >> 5) % 120;
+		}
+		mask = disable();
+		start = DWT->CYCCNT;
+		p = getmem(size);
+		cycles = DWT->CYCCNT - start;
+		restore(mask);
+		if (p == (char *)SYSERR) {
+			nfail++;
+			continue;
+		}
+		hlive[k] = p;
+		hsize[k] = size;
+		if (nget < HEAP_SAMPLES) {
+			hget[nget++] = cycles > 0xFFFF ? 0xFFFF : cycles;
+		}
+	}
+
+	/* Measure fragmentation while the trace still holds blocks	*/
+
+	heapstat(&ms);
+	for (k = 0; k < HEAP_LIVE; k++) {
+		if (hlive[k] != NULL) {
+			freemem(hlive[k], hsize[k]);
+		}
+	}
+
+	printf("%-8s %7s %7s %7s %7s %7s\n", "Op", "Samples", "p50",
+		"p90", "p99", "max");
+	printf("%-8s %7s %7s %7s %7s %7s\n", "--------", "-------",
+		"-------", "-------", "-------", "-------");
+	hprint("getmem", hget, nget);
+	hprint("freemem", hput, nput);
+	printf("latencies in cycles, %d allocations failed\n", nfail);
+	printf("free %d bytes, largest block %d bytes, fragmentation %d%%\n",
+		ms.mfree, ms.mlargest, ms.mfrag / 10);
+}
+
+/*------------------------------------------------------------------------
+ * bench_append - Grow a buffer with realloc a few bytes at a time, the
+ *		   way the interpreters build strings and lists, and
+ *		   report the cost per append and how often it moved
+ *------------------------------------------------------------------------
+ */
+#define	APPEND_BYTES	4096		/* Default final buffer size	*/
+
+local	void	bench_append(
+	  int32		total		/* Final size of the buffer	*/
+	)
+{
+	int32	chunk;			/* Bytes added per append	*/
+	int32	len;			/* Current length of the buffer	*/
+	int32	nappend;		/* Appends done			*/
+	int32	nmove;			/* Appends that moved the data	*/
+	char	*buf, *nbuf;		/* Buffer before and after	*/
+	uint32	start, cycles;		/* DWT cycle counter samples	*/
+
+	if (total <= 0) {
+		total = APPEND_BYTES;
+	}
+
+	printf("%5s %8s %8s %10s\n", "Chunk", "Appends", "Moves",
+		"Cycles/app");
+	printf("%5s %8s %8s %10s\n", "-----", "--------", "--------",
+		"----------");
+
+	for (chunk = 1; chunk <= 256; chunk *= 4) {
+		buf = NULL;
+		len = nappend = nmove = 0;
+		cycles = 0;
+		while (len + chunk <= total) {
+			start = DWT->CYCCNT;
+			nbuf = realloc(buf, len + chunk);
+			cycles += DWT->CYCCNT - start;
+			if (nbuf == NULL) {
+				break;
+			}
+			if (buf != NULL && nbuf != buf) {
+				nmove++;
+			}
+			memset(nbuf + len, 'x', chunk);
+			buf = nbuf;
+			len += chunk;
+			nappend++;
+		}
+		free(buf);
+		if (nappend == 0) {
+			printf("%5d cannot allocate\n", chunk);
+			continue;
+		}
+		printf("%5d %8d %8d %10d\n", chunk, nappend, nmove,
+			cycles / nappend);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * bench_string - Compare the word-at-a-time memcpy, memset and strlen
+ *		   with the byte loops they replaced (kept in bytestr.c),
+ *		   by size and by the alignment of destination and source
+ *------------------------------------------------------------------------
+ */
+#define	STRING_BYTES	4096		/* Default largest size		*/
+#define	STRING_COPIED	16384		/* Bytes moved per measurement	*/
+
+/*------------------------------------------------------------------------
+ * mbps - Convert bytes moved in a number of cycles to MB/s
+ *------------------------------------------------------------------------
+ */
+local	uint32	mbps(
+	  uint32	bytes,		/* Bytes processed		*/
+	  uint32	cycles		/* DWT cycles it took		*/
+	)
+{
+	if (cycles == 0) {
+		return 0;
+	}
+	return (uint32)((uint64)bytes * SystemCoreClock / cycles / 1000000);
+}
+
+local	void	bench_string(
+	  int32		maxn		/* Largest size to measure	*/
+	)
+{
+	static	const	int32	dalign[] = {0, 1, 1};	/* Dst offsets	*/
+	static	const	int32	salign[] = {0, 1, 3};	/* Src offsets	*/
+	char	*dbuf, *sbuf;		/* Buffers from the heap	*/
+	char	*d, *s;			/* Offset into those buffers	*/
+	int32	n;			/* Size being measured		*/
+	int32	a;			/* Index of alignment case	*/
+	int32	i, reps;		/* Repetitions per measurement	*/
+	uint32	start;			/* DWT cycle counter sample	*/
+	uint32	c[6];			/* Cycles for each function	*/
+
+	if (maxn <= 0) {
+		maxn = STRING_BYTES;
+	}
+	dbuf = getmem(maxn + 8);
+	sbuf = getmem(maxn + 8);
+	if (dbuf == (char *)SYSERR || sbuf == (char *)SYSERR) {
+		printf("cannot allocate two %d byte buffers\n", maxn);
+		if (dbuf != (char *)SYSERR) {
+			freemem(dbuf, maxn + 8);
+		}
+		if (sbuf != (char *)SYSERR) {
+			freemem(sbuf, maxn + 8);
+		}
+		return;
+	}
+
+	printf("%5s %5s %13s %13s %13s\n", "Size", "D/S", "memcpy MB/s",
+		"memset MB/s", "strlen MB/s");
+	printf("%5s %5s %6s %6s %6s %6s %6s %6s\n", "", "", "bytes", "words",
+		"bytes", "words", "bytes", "words");
+	printf("%5s %5s %6s %6s %6s %6s %6s %6s\n", "-----", "-----",
+		"------", "------", "------", "------", "------", "------");
+
+	for (n = 16; n <= maxn; n *= 4) {
+		reps = (n >= STRING_COPIED) ? 1 : STRING_COPIED / n;
+		for (a = 0; a < sizeof(dalign) / sizeof(dalign[0]); a++) {
+			d = dbuf + dalign[a];
+			s = sbuf + salign[a];
+			byteset(s, 'x', n - 1);
+			s[n - 1] = '\0';
+
+			start = DWT->CYCCNT;
+			for (i = 0; i < reps; i++) {
+				bytecpy(d, s, n);
+			}
+			c[0] = DWT->CYCCNT - start;
+			start = DWT->CYCCNT;
+			for (i = 0; i < reps; i++) {
+				memcpy(d, s, n);
+			}
+			c[1] = DWT->CYCCNT - start;
+			start = DWT->CYCCNT;
+			for (i = 0; i < reps; i++) {
+				byteset(d, 0, n);
+			}
+			c[2] = DWT->CYCCNT - start;
+			start = DWT->CYCCNT;
+			for (i = 0; i < reps; i++) {
+				memset(d, 0, n);
+			}
+			c[3] = DWT->CYCCNT - start;
+			start = DWT->CYCCNT;
+			for (i = 0; i < reps; i++) {
+				bytelen(s);
+			}
+			c[4] = DWT->CYCCNT - start;
+			start = DWT->CYCCNT;
+			for (i = 0; i < reps; i++) {
+				strlen(s);
+			}
+			c[5] = DWT->CYCCNT - start;
+
+			printf("%5d %3d/%d", n, dalign[a], salign[a]);
+			for (i = 0; i < 6; i++) {
+				printf(" %6d", mbps(n * reps, c[i]));
+			}
+			printf("\n");
+		}
+	}
+	freemem(dbuf, maxn + 8);
+	freemem(sbuf, maxn + 8);
+}
+
+/*------------------------------------------------------------------------
+ * bench_printf - Time sprintf on each kind of conversion and on a
+ *		   typical log line, so changes to the number formatting
+ *		   in lib/fmtnum.c can be compared
+ *------------------------------------------------------------------------
+ */
+#define	PRINTF_LINES	1000		/* Default calls per format	*/
+
+local	void	bench_printf(
+	  int32		nlines		/* Calls to time per format	*/
+	)
+{
+	char	line[96];		/* Output of each call		*/
+	int32	i;			/* Counts calls			*/
+	int32	f;			/* Index of format being timed	*/
+	uint32	start, cycles;		/* DWT cycle counter samples	*/
+	uint32	n;			/* Value that varies per call	*/
+
+	if (nlines <= 0) {
+		nlines = PRINTF_LINES;
+	}
+
+	printf("%-24s %10s %10s\n", "Format", "Cycles", "Calls/s");
+	printf("%-24s %10s %10s\n", "------------------------",
+		"----------", "----------");
+
+	for (f = 0; f < 6; f++) {
+		n = 0x9E3779B9;
+		start = DWT->CYCCNT;
+		for (i = 0; i < nlines; i++) {
+			n = n * 1664525 + 1013904223;
+			switch (f) {
+			case 0:
+				sprintf(line, "%d", (int32)n);
+				break;
+			case 1:
+				sprintf(line, "%u", n >> (n & 31));
+				break;
+			case 2:
+				sprintf(line, "%08X", n);
+				break;
+			case 3:
+				sprintf(line, "%.3f", (float)(n >> 12) / 64.0f);
+				break;
+			case 4:
+				sprintf(line, "%s", "0123456789abcdef");
+				break;
+			default:
+				sprintf(line, "%-8s %6d %08x %8.2f\n", "sensor",
+					n & 0xFFFF, n, (float)(n >> 16) / 100.0f);
+				break;
+			}
+		}
+		cycles = (DWT->CYCCNT - start) / nlines;
+		printf("%-24s %10d %10d\n",
+			(f == 0) ? "%d" : (f == 1) ? "%u" : (f == 2) ? "%08X" :
+			(f == 3) ? "%.3f" : (f == 4) ? "%s" :
+			"%-8s %6d %08x %8.2f", cycles,
+			(cycles == 0) ? 0 : SystemCoreClock / cycles);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * bench_fat - Write a file sequentially, then open it and read at
+ *		random offsets, reporting the time of each phase and what
+ *		the FAT sector cache did during it
+ *------------------------------------------------------------------------
+ */
+#define	FAT_KBYTES	64		/* Default file size in KB	*/
+#define	FAT_SEEKS	50		/* Opens and seeks timed	*/
+#define	FAT_FILE	"/bench.tmp"	/* Scratch file (removed after)	*/
+
+local	void	fatprint(
+	  char		*phase,		/* Name of the phase		*/
+	  uint32	ms,		/* Elapsed milliseconds		*/
+	  uint32	rate,		/* KB/s or ops/s		*/
+	  struct fat_stats *before,	/* Counters at the start	*/
+	  struct fat_stats *after	/* Counters at the end		*/
+	)
+{
+	printf("%-6s %8d %8d %8d %8d %8d %8d\n", phase, ms, rate,
+		after->hits - before->hits, after->misses - before->misses,
+		after->writes - before->writes,
+		after->sectors - before->sectors);
+}
+
+local	void	bench_fat(
+	  int32		nkb		/* Size of the file in KB	*/
+	)
+{
+	static	char	buf[FAT_SECTOR_SIZE];	/* Data written and read	*/
+	struct	fat_stats before, after;	/* Cache counters	*/
+	FL_FILE	*fp;			/* Scratch file			*/
+	uint32	start, ms;		/* Times in ms			*/
+	uint32	n;			/* Value that varies per op	*/
+	int32	i;			/* Counts chunks and seeks	*/
+
+	if (nkb <= 0) {
+		nkb = FAT_KBYTES;
+	}
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = i;
+	}
+
+	printf("%-6s %8s %8s %8s %8s %8s %8s\n", "Phase", "ms", "Rate",
+		"Hits", "Misses", "Writes", "Sectors");
+	printf("%-6s %8s %8s %8s %8s %8s %8s\n", "------", "--------",
+		"--------", "--------", "--------", "--------", "--------");
+
+	/* Sequential write; the rate is KB/s */
+
+	fl_fatstats(&before);
+	start = tmnow;
+	if ((fp = fl_fopen(FAT_FILE, "w")) == NULL) {
+		printf("cannot create %s\n", FAT_FILE);
+		return;
+	}
+	for (i = 0; i < nkb * 1024 / FAT_SECTOR_SIZE; i++) {
+		if (fl_fwrite(buf, 1, sizeof(buf), fp) != sizeof(buf)) {
+			printf("write failed after %d KB\n",
+				i * FAT_SECTOR_SIZE / 1024);
+			break;
+		}
+	}
+	nkb = i * FAT_SECTOR_SIZE / 1024;
+	fl_fclose(fp);
+	ms = tmnow - start;
+	fl_fatstats(&after);
+	fatprint("write", ms, (ms == 0) ? 0 : nkb * 1000 / ms, &before,
+		&after);
+
+	/* Open, seek to a random offset and read; the rate is ops/s */
+
+	n = 0x9E3779B9;
+	fl_fatstats(&before);
+	start = tmnow;
+	for (i = 0; i < FAT_SEEKS && nkb > 0; i++) {
+		n = n * 1664525 + 1013904223;
+		if ((fp = fl_fopen(FAT_FILE, "r")) == NULL) {
+			break;
+		}
+		fl_fseek(fp, (n >> 8) % (nkb * 1024 - 16), SEEK_SET);
+		fl_fread(buf, 1, 16, fp);
+		fl_fclose(fp);
+	}
+	ms = tmnow - start;
+	fl_fatstats(&after);
+	fatprint("seek", ms, (ms == 0) ? 0 : i * 1000 / ms, &before,
+		&after);
+
+	fl_remove(FAT_FILE);
+}
+
+/*------------------------------------------------------------------------
+ * bench_fopen - Time opening a file at the end of a deep path and the
+ *		last file of a large directory, with what the directory
+ *		entry cache and the FAT sector cache did meanwhile
+ *------------------------------------------------------------------------
+ */
+#define	OPEN_FILES	64		/* Default files in the big dir	*/
+#define	OPEN_REPS	100		/* Opens timed per path		*/
+#define	OPEN_ROOT	"/benchdir"	/* Directories (left behind)	*/
+#define	OPEN_DEEP	OPEN_ROOT "/level one/level two/level three"
+
+local	void	openprint(
+	  char		*what,		/* Path being opened		*/
+	  uint32	ms,		/* Elapsed milliseconds		*/
+	  struct fat_stats *before,	/* Counters at the start	*/
+	  struct fat_stats *after	/* Counters at the end		*/
+	)
+{
+	printf("%-8s %8d %8d %8d %8d %8d\n", what, ms,
+		(ms == 0) ? 0 : OPEN_REPS * 1000 / ms,
+		after->dentry_hits - before->dentry_hits,
+		after->dentry_misses - before->dentry_misses,
+		after->misses - before->misses);
+}
+
+local	void	bench_fopen(
+	  int32		nfiles		/* Files in the big directory	*/
+	)
+{
+	char	path[64];		/* Name of a file		*/
+	struct	fat_stats before, after;	/* Cache counters	*/
+	FL_FILE	*fp;			/* File being opened		*/
+	uint32	start;			/* Time in ms			*/
+	int32	i;			/* Counts files and opens	*/
+
+	if (nfiles <= 0) {
+		nfiles = OPEN_FILES;
+	}
+
+	/* Build the tree; directories that exist already are kept	*/
+
+	fl_createdirectory(OPEN_ROOT);
+	fl_createdirectory(OPEN_ROOT "/level one");
+	fl_createdirectory(OPEN_ROOT "/level one/level two");
+	fl_createdirectory(OPEN_DEEP);
+	fl_createdirectory(OPEN_ROOT "/big");
+	if ((fp = fl_fopen(OPEN_DEEP "/deep.txt", "w")) == NULL) {
+		printf("cannot create %s\n", OPEN_DEEP "/deep.txt");
+		return;
+	}
+	fl_fclose(fp);
+	for (i = 0; i < nfiles; i++) {
+		sprintf(path, OPEN_ROOT "/big/entry %03d.txt", i);
+		if ((fp = fl_fopen(path, "w")) == NULL) {
+			printf("cannot create %s\n", path);
+			nfiles = i;
+			break;
+		}
+		fl_fclose(fp);
+	}
+
+	printf("%-8s %8s %8s %8s %8s %8s\n", "Path", "ms", "Opens/s",
+		"DHits", "DMisses", "FATMiss");
+	printf("%-8s %8s %8s %8s %8s %8s\n", "--------", "--------",
+		"--------", "--------", "--------", "--------");
+
+	/* Four directories down */
+
+	fl_fatstats(&before);
+	start = tmnow;
+	for (i = 0; i < OPEN_REPS; i++) {
+		if ((fp = fl_fopen(OPEN_DEEP "/deep.txt", "r")) != NULL) {
+			fl_fclose(fp);
+		}
+	}
+	fl_fatstats(&after);
+	openprint("deep", tmnow - start, &before, &after);
+
+	/* Last entry of the big directory */
+
+	if (nfiles > 0) {
+		sprintf(path, OPEN_ROOT "/big/entry %03d.txt", nfiles - 1);
+		fl_fatstats(&before);
+		start = tmnow;
+		for (i = 0; i < OPEN_REPS; i++) {
+			if ((fp = fl_fopen(path, "r")) != NULL) {
+				fl_fclose(fp);
+			}
+		}
+		fl_fatstats(&after);
+		openprint("bigdir", tmnow - start, &before, &after);
+	}
+
+	fl_remove(OPEN_DEEP "/deep.txt");
+	for (i = 0; i < nfiles; i++) {
+		sprintf(path, OPEN_ROOT "/big/entry %03d.txt", i);
+		fl_remove(path);
+	}
+}
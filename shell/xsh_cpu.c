@@ -1,52 +1,60 @@
-/* xsh_echo.c - xsh_echo */
+/* xsh_cpu.c - xsh_cpu */
 
 #include <xinu.h>
-#include <fat_filelib.h>
+#include <stdio.h>
+#include <string.h>
 
- 
-#define CPU_CLOCK_HZ 84000000  // 100 MHz
-#define TICK_HZ 100000000 / 1000            // 1 ms por tick
-
-
-uint32 totalTicks = 0;    // Contador de tiempo total (ticks)
-extern uint32 idleTicks;     // Contador de tiempo en la tarea idle
-
- 
-
-uint32 calculateIdleTimePercentage(void) {
-    totalTicks = (uint32)cycleCount();
-    if (totalTicks == 0) {
-        return 0;  // Evitar división por cero
-    }
-
-    // Calcular el porcentaje de tiempo en idle
-    uint32 idlePercentage = (idleTicks / totalTicks) ;
-    return idlePercentage;
-}
-uint32 calculateProcessingTimePercentage(void) {
-
-
-    totalTicks = (uint32)cycleCount();
-    if (totalTicks == 0) {
-        return 0.0;  // Evitar división por cero
-    }
-
-    // Calcular el porcentaje de tiempo procesando tareas
-    uint32_t processingTicks = totalTicks - idleTicks;  // Ticks en los que el CPU está procesando
-    uint32 processingPercentage = (processingTicks / totalTicks);
-
-    return processingPercentage;
-}
-
-void showIdleTime(void) {
-    uint32 idlePercentage = calculateProcessingTimePercentage();//calculateIdleTimePercentage();
-    printf(" time: %d\n", idlePercentage);
-}
+extern	uint32_t SystemCoreClock;
 
+/*------------------------------------------------------------------------
+ * xsh_cpu - shell command to report idle versus busy CPU time
+ *------------------------------------------------------------------------
+ */
 shellcmd xsh_cpu(int nargs, char *args[])
 {
-	 showIdleTime();
-  
- 
+	intmask	mask;			/* saved interrupt mask		*/
+	uint64	total;			/* cycles charged since boot	*/
+	uint64	idle;			/* cycles used by null process	*/
+	uint32	pct;			/* busy share in tenths of a %	*/
+	uint32	khz;			/* core clock in kHz		*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tDisplays CPU time spent idle and running processes\n");
+		printf("Options:\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	if (nargs > 1) {
+		fprintf(stderr, "%s: too many arguments\n", args[0]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+
+	/* Time the null process runs, including WFI, is idle time	*/
+
+	mask = disable();
+	cpucharge();
+	total = cpucycles;
+	idle = proctab[NULLPROC].prcycles;
+	restore(mask);
+
+	khz = SystemCoreClock / 1000;
+	pct = (total == 0) ? 0 : (uint32)((total - idle) * 1000 / total);
+	printf(" uptime:   %d ms\n", (uint32)(total / khz));
+	printf(" busy:     %d ms (%d.%d%%)\n", (uint32)((total - idle) / khz),
+		pct / 10, pct % 10);
+	printf(" idle:     %d ms (%d.%d%%)\n", (uint32)(idle / khz),
+		(1000 - pct) / 10, (1000 - pct) % 10);
+	printf(" tickless: %d ticks skipped, %d idle wakeups\n",
+		clkskipped, clkwakeups);
+#if INTRTRACE
+	printf(" masked:   longest %d cycles, ended before 0x%08X\n",
+		intrmax, intrmaxpc);
+#endif
+
 	return 0;
 }
@@ -0,0 +1,33 @@
+/* xsh_df.c - xsh_df */
+
+#include <xinu.h>
+#include <fat_filelib.h>
+
+/*------------------------------------------------------------------------
+ * xsh_df - show the size of the FAT volume and the space left on it
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_df(int nargs, char *args[])
+{
+	uint32	total;			/* Size of the volume in KB	*/
+	uint32	avail;			/* Free space in KB		*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Usage: %s\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tShows the size and free space of the volume\n");
+		printf("Options:\n");
+		printf("\t--help\tdisplay this help and exit\n");
+		return 0;
+	}
+
+	if (fl_diskfree(&total, &avail) != 0) {
+		fprintf(stderr, "%s: no volume mounted\n", args[0]);
+		return 1;
+	}
+
+	printf("%10s %10s %10s %4s\n", "KB", "Used", "Free", "Use%");
+	printf("%10d %10d %10d %3d%%\n", total, total - avail, avail,
+		total ? (int32)(((uint64)(total - avail) * 100) / total) : 0);
+	return 0;
+}
@@ -6,6 +6,12 @@
 
 static	void	printMemUse(void);
 static	void	printFreeList(void);
+static	void	printSlabStats(void);
+static	void	printOwners(void);
+static	void	printHeapStats(void);
+#if MEMTRACE
+static	void	printSites(void);
+#endif
 
 /*------------------------------------------------------------------------
  * xsh_memstat - Print statistics about memory use and dump the free list
@@ -20,7 +26,10 @@ shellcmd xsh_memstat(int nargs, char *args[])
 		printf("use: %s \n\n", args[0]);
 		printf("Description:\n");
 		printf("\tDisplays the current memory use and prints the\n");
-		printf("\tfree list.\n");
+		printf("\tfree list and the malloc size class statistics.\n");
+		printf("\tThe summary shows the free block histogram,\n");
+		printf("\tfragmentation, peak use and the getmem/freemem\n");
+		printf("\trates since the previous memstat.\n");
 		printf("Options:\n");
 		printf("\t--help\t\tdisplay this help and exit\n");
 		return 0;
@@ -52,6 +61,12 @@ shellcmd xsh_memstat(int nargs, char *args[])
 	
 	//printMemUse();
 	printFreeList();
+	printHeapStats();
+	printSlabStats();
+	printOwners();
+#if MEMTRACE
+	printSites();
+#endif
 
 	return 0;
 }
@@ -64,7 +79,9 @@ shellcmd xsh_memstat(int nargs, char *args[])
  */
 static void printFreeList(void)
 {
-	struct memblk *block;
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	memhdr	*block;		/* Walks the heap in address order*/
+	uint32	addr, len;		/* Copy of a free block		*/
 
 	/* Output a heading for the free list */
 
@@ -73,14 +90,159 @@ static void printFreeList(void)
 	//printf("Free List:\n");
 	printf("Block address  Length (dec)  Length (hex)\n");
 	printf("-------------  ------------  ------------\n");
-	
-	for (block = memlist.mnext; block != NULL; block = block->mnext) {
-		printf("  0x%08x    %9d     0x%08x\n", block,
-			block->mlength, block->mlength);
+
+	/* Printing can block, so each free block is found by a fresh	*/
+	/*   walk of the heap; the zero-size block at the top ends it	*/
+
+	addr = 0;
+	for (;;) {
+		mask = disable();
+		for (block = (struct memhdr *)minheap; mblksize(block) != 0;
+						block = mblknext(block)) {
+			if ((block->msize & MFREE) && (uint32)block > addr) {
+				break;
+			}
+		}
+		addr = (uint32)block;
+		len = mblksize(block);
+		restore(mask);
+		if (len == 0) {
+			break;
+		}
+		printf("  0x%08x    %9d     0x%08x\n", addr, len, len);
+	}
+	printf("\n");
+}
+
+/*------------------------------------------------------------------------
+ * printHeapStats - Print the free block histogram, fragmentation, peak
+ *			use and allocation rates from heapstat
+ *------------------------------------------------------------------------
+ */
+static void printHeapStats(void)
+{
+	static	struct	memstat	last;	/* Snapshot of previous memstat	*/
+	struct	memstat	ms;		/* Snapshot taken now		*/
+	uint32	lo, hi;			/* Size range of a bin		*/
+	uint32	elapsed;		/* Milliseconds since last	*/
+	int32	i;			/* Index into histogram		*/
+
+	heapstat(&ms);
+
+	printf("Free blocks     Count\n");
+	printf("--------------  -----\n");
+	for (i = 0; i < MFLCOUNT; i++) {
+		if (ms.mhist[i] == 0) {
+			continue;
+		}
+		lo = (i == 0) ? MMINBLK : 1U << (MFLSHIFT + i - 1);
+		hi = (1U << (MFLSHIFT + i)) - 1;
+		printf("%6d-%-7d  %5d\n", lo, hi, ms.mhist[i]);
+	}
+	printf("%d bytes free in %d blocks of %d, largest getmem %d\n",
+		ms.mfree, ms.mnfree, ms.mtotal, ms.mlargest);
+	printf("fragmentation %d.%d%%, peak use %d bytes\n",
+		ms.mfrag / 10, ms.mfrag % 10, ms.mpeak);
+
+	/* Rates cover the time since the previous memstat		*/
+
+	if (last.mtime != 0 && (elapsed = ms.mtime - last.mtime) != 0) {
+		printf("%d getmem/s, %d freemem/s over %d ms\n",
+			(ms.mgets - last.mgets) * 1000 / elapsed,
+			(ms.mputs - last.mputs) * 1000 / elapsed,
+			elapsed);
+	} else {
+		printf("%d getmem, %d freemem since boot\n",
+			ms.mgets, ms.mputs);
 	}
 	printf("\n");
+	last = ms;
 }
 
+/*------------------------------------------------------------------------
+ * printSlabStats - Print the use of each malloc size class
+ *------------------------------------------------------------------------
+ */
+static void printSlabStats(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	slabclass stats[NSLAB];	/* Snapshot of the slab table	*/
+	uint32	held, used;		/* Bytes in pages, in objects	*/
+	int32	i;			/* Index into the slab table	*/
+
+	mask = disable();
+	memcpy(stats, slabtab, sizeof(stats));
+	restore(mask);
+
+	printf("Size  Pages  In use    Allocs     Frees\n");
+	printf("----  -----  ------  --------  --------\n");
+	held = used = 0;
+	for (i = 0; i < NSLAB; i++) {
+		printf("%4d  %5d  %6d  %8d  %8d\n", stats[i].ssize,
+			stats[i].snpages, stats[i].sinuse, stats[i].sallocs,
+			stats[i].sfrees);
+		held += stats[i].snpages * PAGE_SIZE;
+		used += stats[i].sinuse * stats[i].ssize;
+	}
+	printf("%d bytes in slab pages, %d bytes in use\n\n", held, used);
+}
+
+/*------------------------------------------------------------------------
+ * printOwners - Print the malloc memory held by each process
+ *------------------------------------------------------------------------
+ */
+static void printOwners(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint32	heap[NPROC];		/* Bytes each process owns	*/
+	char	name[NPROC][PNMLEN];	/* Name of each process		*/
+	int32	i;			/* Index into process table	*/
+
+	mask = disable();
+	for (i = 0; i < NPROC; i++) {
+		heap[i] = (proctab[i].prstate == PR_FREE) ? 0
+				: proctab[i].prheap;
+		memcpy(name[i], proctab[i].prname, PNMLEN);
+	}
+	restore(mask);
+
+	printf("Pid  Name              Heap bytes\n");
+	printf("---  ----------------  ----------\n");
+	for (i = 0; i < NPROC; i++) {
+		if (heap[i] != 0) {
+			printf("%3d  %-16s  %10d\n", i, name[i], heap[i]);
+		}
+	}
+	printf("\n");
+}
+
+#if MEMTRACE
+/*------------------------------------------------------------------------
+ * printSites - Print the malloc calls made from each call site
+ *------------------------------------------------------------------------
+ */
+static void printSites(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	memsite	sites[NMEMSITE];/* Snapshot of the site table	*/
+	uint32	miss;			/* Calls from untracked sites	*/
+	int32	i;			/* Index into the site table	*/
+
+	mask = disable();
+	memcpy(sites, memsites, sizeof(sites));
+	miss = memsitemiss;
+	restore(mask);
+
+	printf("Call site        Calls       Bytes\n");
+	printf("----------  ----------  ----------\n");
+	for (i = 0; i < NMEMSITE && sites[i].mspc != NULL; i++) {
+		printf("0x%08X  %10d  %10d\n", sites[i].mspc,
+			sites[i].mscalls, sites[i].msbytes);
+	}
+	printf("%d calls from other sites\n\n", miss);
+}
+#endif
+
 extern void start(void);
 extern void *_end;
 
@@ -96,7 +258,6 @@ static void printMemUse(void)
 	uint32 mspstack = HANDLERSTACK; /* Total used handler stack mem */
 	uint32 kheap = 0;		/* Free kernel heap memory	*/
 	uint32 kfree = 0;		/* Total free memory		*/
-	struct memblk *block;	 	/* Ptr to memory block		*/
 
 	/* Calculate amount of text memory */
 
@@ -113,9 +274,7 @@ static void printMemUse(void)
 
 	/* Calculate the amount of memory on the free list */
 
-	for (block = memlist.mnext; block != NULL; block = block->mnext) {
-		kfree += block->mlength;
-	}
+	kfree = heap_free();
 
 	/* Calculate the amount of free kernel heap memory */
 
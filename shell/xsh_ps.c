@@ -17,9 +17,14 @@ shellcmd xsh_ps(int nargs, char *args[])
 
 	struct	procent	*prptr;		/* pointer to process		*/
 	int32	i;			/* index into proctabl		*/
+	intmask	mask;			/* saved interrupt mask		*/
+	uint64	used[NPROC];		/* cycles used by each process	*/
+	uint64	life[NPROC];		/* cycles since each was made	*/
+	uint32	heap[NPROC];		/* malloc bytes each one owns	*/
+	uint32	pct;			/* CPU share in tenths of a %	*/
 	char *pstate[]	= {		/* names for process states	*/
 		"free ", "curr ", "ready", "recv ", "sleep", "susp ",
-		"wait ", "rtime"};
+		"wait ", "rtime", "mutex"};
 
 	/* For argument '--help', emit help about the 'ps' command	*/
 
@@ -42,15 +47,28 @@ shellcmd xsh_ps(int nargs, char *args[])
 		return 1;
 	}
 
+	/* Take a consistent snapshot of the cycle counts; a process's	*/
+	/*   CPU share is measured over its own lifetime		*/
+
+	mask = disable();
+	cpucharge();
+	for (i = 0; i < NPROC; i++) {
+		used[i] = proctab[i].prcycles;
+		life[i] = cpucycles - proctab[i].prbirth;
+		heap[i] = proctab[i].prheap;
+	}
+	restore(mask);
+
 	/* Print header for items from the process table */
 
-	printf("%3s %-16s %5s %4s %4s %10s %-10s %10s\n",
+	printf("%3s %-16s %5s %4s %4s %10s %-10s %10s %8s %5s %6s\n",
 		   "Pid", "Name", "State", "Prio", "Ppid", "Stack Base",
-		   "Stack Ptr", "Stack Size");
+		   "Stack Ptr", "Stack Size", "Switches", " %CPU", "Heap");
 
-	printf("%3s %-16s %5s %4s %4s %10s %-10s %10s\n",
+	printf("%3s %-16s %5s %4s %4s %10s %-10s %10s %8s %5s %6s\n",
 		   "---", "----------------", "-----", "----", "----",
-		   "----------", "----------", "----------");
+		   "----------", "----------", "----------", "--------",
+		   "-----", "------");
 
 	/* Output information for each process */
 
@@ -59,10 +77,12 @@ shellcmd xsh_ps(int nargs, char *args[])
 		if (prptr->prstate == PR_FREE) {  /* skip unused slots	*/
 			continue;
 		}
-		printf("%3d %-16s %s %4d %4d 0x%08X 0x%08X %8d\n",
+		pct = (life[i] == 0) ? 0 : (uint32)(used[i] * 1000 / life[i]);
+		printf("%3d %-16s %s %4d %4d 0x%08X 0x%08X %8d %8d %3d.%d %6d\n",
 			i, prptr->prname, pstate[(int)prptr->prstate],
 			prptr->prprio, prptr->prparent, prptr->prstkbase,
-			prptr->prstkptr, prptr->prstklen);
+			prptr->prstkptr, prptr->prstklen, prptr->prctxsw,
+			pct / 10, pct % 10, heap[i]);
 	}
 
 	return 0;
@@ -24,6 +24,7 @@ shellcmd xsh_run(int nargs, char *args[])
         prptr = &proctab[child];
         prptr->elf = TRUE;
         prptr->img = (void *)ximg.start;
+        heapgive(prptr->img, child);    /* outlives this command */
 
         resume(child);
 
@@ -1,16 +1,173 @@
-/* xsh_echo.c - xsh_echo */
+/* xsh_test.c - xsh_test */
 
 #include <xinu.h>
-#include <fat_filelib.h>
- 
- 
+#include <string.h>
+#include <elf.h>
 
+local	int32	test_run(char *);
 
+/* Table of tests that can be selected from the command line		*/
 
+local	const	struct	{
+	char	*tname;			/* Name of test			*/
+	int32	(*tfunc)(char *);	/* Function that runs it	*/
+	char	*thelp;			/* One line description		*/
+} testtab[] = {
+	{"run",		test_run,	"ELF whose loader exits first keeps its image"},
+};
+
+#define	NTESTS	(sizeof(testtab) / sizeof(testtab[0]))
+
+/*------------------------------------------------------------------------
+ * xsh_test - Run one of the built-in tests and report PASS or FAIL
+ *------------------------------------------------------------------------
+ */
 shellcmd xsh_test(int nargs, char *args[])
 {
+	int32	i;			/* Index into testtab		*/
+
+	if (nargs < 2 || strncmp(args[1], "--help", 7) == 0) {
+		printf("Usage: %s <test> [arg]\n\n", args[0]);
+		printf("Tests:\n");
+		for (i = 0; i < NTESTS; i++) {
+			printf("\t%-8s %s\n", testtab[i].tname,
+				testtab[i].thelp);
+		}
+		return 0;
+	}
+
+	for (i = 0; i < NTESTS; i++) {
+		if (strcmp(args[1], testtab[i].tname) == 0) {
+			return testtab[i].tfunc(nargs > 2 ? args[2] : NULL);
+		}
+	}
+	fprintf(stderr, "%s: no test named %s\n", args[0], args[1]);
+	return 1;
+}
+
+/*------------------------------------------------------------------------
+ * test_run - Load an ELF from a process that exits before the program
+ *		starts, as the run command does, and check that the code
+ *		image stays with the program until it ends and is freed
+ *		exactly once then
+ *------------------------------------------------------------------------
+ */
+#define	RUN_WAIT	10000		/* ms the program may run	*/
+
+local	struct	{
+	char	path[SHELL_BUFLEN];	/* ELF file to load		*/
+	char	*argv[2];		/* Arguments of the program	*/
+	pid32	child;			/* Process running the program	*/
+	uint32	held;			/* Its heap bytes when created	*/
+} runtest;
+
+/*------------------------------------------------------------------------
+ * runloader - Load the ELF, start it at a priority below the tester
+ *		so it cannot run yet, and exit
+ *------------------------------------------------------------------------
+ */
+local	process	runloader(
+	  pri16		prio		/* Priority to give the program	*/
+	)
+{
+	exec_img ximg;			/* Where the image was loaded	*/
+	struct	procent *prptr;		/* Entry of the program		*/
+	int32	entry;			/* Entry point of the program	*/
+	pid32	child;			/* Process running the program	*/
+
+	entry = elf_execve(runtest.path, &ximg);
+	if (entry <= 0) {
+		return SYSERR;
+	}
+	child = create((void *)entry, SHELL_CMDSTK, prio, runtest.path,
+			2, 1, runtest.argv);
+	if (child == SYSERR) {
+		free(ximg.start);
+		return SYSERR;
+	}
+	prptr = &proctab[child];
+	prptr->elf = TRUE;
+	prptr->img = ximg.start;
+	heapgive(prptr->img, child);
+	runtest.held = prptr->prheap;
+	runtest.child = child;
+	resume(child);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ * heapleft - Free heap bytes, counting pages that slabs keep as free
+ *------------------------------------------------------------------------
+ */
+local	uint32	heapleft(void)
+{
+	uint32	n;			/* Bytes found so far		*/
+	int32	i;			/* Index into slabtab		*/
+
+	n = memfree;
+	for (i = 0; i < NSLAB; i++) {
+		n += slabtab[i].snpages * PAGE_SIZE;
+	}
+	return n;
+}
+
+local	int32	test_run(
+	  char		*file		/* ELF file to run		*/
+	)
+{
+	pri16	prio;			/* Priority of this process	*/
+	pid32	loader;			/* Process that loads the ELF	*/
+	uint32	before, after;		/* Free heap bytes		*/
+	uint32	held;			/* Program's heap after loader	*/
+	int32	waited;			/* ms spent waiting		*/
+
+	if (file == NULL) {
+		fprintf(stderr, "test run: needs an ELF file\n");
+		return 1;
+	}
+	strncpy(runtest.path, full_path(file), SHELL_BUFLEN - 1);
+	runtest.argv[0] = runtest.path;
+	runtest.argv[1] = NULL;
+	runtest.child = SYSERR;
+
+	/* The loader runs at once and exits; the program waits */
+
+	prio = getprio(getpid());
+	before = heapleft();
+	loader = create(runloader, SHELL_CMDSTK, prio + 1, "runloader",
+			1, prio - 1);
+	resume(loader);
+	if (recvtime(RUN_WAIT) != loader || runtest.child == SYSERR) {
+		printf("FAIL: could not load %s\n", runtest.path);
+		return 1;
+	}
+
+	/* Killing the loader must leave the image with the program	*/
+
+	held = proctab[runtest.child].prheap;
+	if (held < runtest.held) {
+		printf("FAIL: image freed with its loader (%d of %d bytes)\n",
+			held, runtest.held);
+		kill(runtest.child);
+		return 1;
+	}
 
- 
+	/* Let the program run to its end, then look for a leak	*/
 
+	for (waited = 0; proctab[runtest.child].prstate != PR_FREE
+			&& waited < RUN_WAIT; waited += 10) {
+		sleepms(10);
+	}
+	if (proctab[runtest.child].prstate != PR_FREE) {
+		printf("program still running after %d ms, killed\n",
+			RUN_WAIT);
+		kill(runtest.child);
+	}
+	after = heapleft();
+	if (after != before) {
+		printf("FAIL: %d heap bytes not returned\n", before - after);
+		return 1;
+	}
+	printf("PASS\n");
 	return 0;
 }
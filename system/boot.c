@@ -207,6 +207,17 @@ void set_sysclk_to_168(void)
 
 
 
+/* Give thread and handler code full access to the FPU and turn on
+ * automatic, lazy saving of s0-s15/FPSCR on exception entry so only
+ * processes that use floating point get an extended stack frame */
+static void FPUInit(void)
+{
+    SCB->CPACR |= (3UL << 20) | (3UL << 22);   /* CP10, CP11 */
+    FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+    __DSB();
+    __ISB();
+}
+
 static void DWTInit(void)
 {
     CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
@@ -272,6 +283,7 @@ void Reset_Handler(void) {
     for (dst = &_sbss; dst < &_ebss; dst++)
         *dst = 0;
      disable();
+    FPUInit();
     
 
     _BST(RCC->AHB1ENR, RCC_AHB1ENR_GPIOAEN);
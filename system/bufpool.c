@@ -0,0 +1,182 @@
+/* bufpool.c - bufinit, mkbufpool, getbuf, nbgetbuf, freebuf */
+
+#include <xinu.h>
+
+struct	bpentry	buftab[NBPOOLS];	/* Buffer pool table		*/
+bpid32	nbpools;			/* Number of pools allocated	*/
+
+/*------------------------------------------------------------------------
+ *  bufinit  -  Initialize the buffer pool data structure
+ *------------------------------------------------------------------------
+ */
+status	bufinit(void)
+{
+	nbpools = 0;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  mkbufpool  -  Allocate memory for a buffer pool and link the buffers
+ *------------------------------------------------------------------------
+ */
+bpid32	mkbufpool(
+	  int32		bufsiz,		/* Size of a buffer in the pool	*/
+	  int32		numbufs		/* Number of buffers in the pool*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	bpid32	poolid;			/* ID of pool that is created	*/
+	struct	bpentry	*bpptr;		/* Pointer to entry in buftab	*/
+	char	*buf;			/* Pointer to memory for buffer	*/
+	uint32	total;			/* Bytes of memory for the pool	*/
+
+	mask = disable();
+	if (bufsiz<BP_MINB || bufsiz>BP_MAXB
+	    || numbufs<1 || numbufs>BP_MAXN
+	    || nbpools >= NBPOOLS) {
+		restore(mask);
+		return (bpid32)SYSERR;
+	}
+
+	/* Round request to a multiple of the heap's 8-byte alignment	*/
+
+	bufsiz = (int32) roundmb(bufsiz);
+	total = numbufs * (bufsiz + BP_HDR);
+	if ( (buf = (char *)getmem(total)) == (char *)SYSERR ) {
+		restore(mask);
+		return (bpid32)SYSERR;
+	}
+	poolid = nbpools++;
+	bpptr = &buftab[poolid];
+	bpptr->bpnext = (struct bpentry *)buf;
+	bpptr->bpsize = bufsiz;
+	if ( (bpptr->bpsem = semcreate(numbufs)) == SYSERR) {
+		freemem(buf, total);
+		nbpools--;
+		restore(mask);
+		return (bpid32)SYSERR;
+	}
+	bufsiz += BP_HDR;
+	for (numbufs-- ; numbufs>0 ; numbufs-- ) {
+		bpptr = (struct bpentry *)buf;
+		buf += bufsiz;
+		bpptr->bpnext = (struct bpentry *)buf;
+	}
+	bpptr = (struct bpentry *)buf;
+	bpptr->bpnext = (struct bpentry *)NULL;
+	restore(mask);
+	return poolid;
+}
+
+/*------------------------------------------------------------------------
+ *  getbuf  -  Get a buffer from a preestablished buffer pool, waiting
+ *		 until one is free
+ *------------------------------------------------------------------------
+ */
+char	*getbuf(
+	  bpid32	poolid		/* Index of pool in buftab	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	bpentry	*bpptr;		/* Pointer to entry in buftab	*/
+	struct	bpentry	*bufptr;	/* Pointer to a buffer		*/
+
+	mask = disable();
+
+	/* Check arguments */
+
+	if ( (poolid < 0  ||  poolid >= nbpools) ) {
+		restore(mask);
+		return (char *)SYSERR;
+	}
+	bpptr = &buftab[poolid];
+
+	/* Wait for pool to have > 0 buffers and allocate a buffer */
+
+	if (wait(bpptr->bpsem) == SYSERR) {
+		restore(mask);
+		return (char *)SYSERR;
+	}
+	bufptr = bpptr->bpnext;
+
+	/* Unlink buffer from pool */
+
+	bpptr->bpnext = bufptr->bpnext;
+
+	/* Record pool ID in the buffer header and skip over it */
+
+	*(bpid32 *)bufptr = poolid;
+	restore(mask);
+	return (char *)bufptr + BP_HDR;
+}
+
+/*------------------------------------------------------------------------
+ *  nbgetbuf  -  Get a buffer from a pool without waiting, returning
+ *		   SYSERR if the pool is empty (safe in an interrupt
+ *		   handler that runs at or below the kernel ceiling)
+ *------------------------------------------------------------------------
+ */
+char	*nbgetbuf(
+	  bpid32	poolid		/* Index of pool in buftab	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	bpentry	*bpptr;		/* Pointer to entry in buftab	*/
+	struct	bpentry	*bufptr;	/* Pointer to a buffer		*/
+	struct	sentry	*semptr;	/* Semaphore counting buffers	*/
+
+	mask = disable();
+	if ( (poolid < 0  ||  poolid >= nbpools) ) {
+		restore(mask);
+		return (char *)SYSERR;
+	}
+	bpptr = &buftab[poolid];
+
+	/* A positive count means no process waits, so taking one	*/
+	/*   is a wait that cannot block				*/
+
+	semptr = &semtab[bpptr->bpsem];
+	if (semptr->scount <= 0) {
+		restore(mask);
+		return (char *)SYSERR;
+	}
+	semptr->scount--;
+	bufptr = bpptr->bpnext;
+	bpptr->bpnext = bufptr->bpnext;
+	*(bpid32 *)bufptr = poolid;
+	restore(mask);
+	return (char *)bufptr + BP_HDR;
+}
+
+/*------------------------------------------------------------------------
+ *  freebuf  -  Free a buffer that was allocated from a pool by getbuf
+ *------------------------------------------------------------------------
+ */
+syscall	freebuf(
+	  char		*bufaddr	/* Address of buffer to return	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	bpentry	*bpptr;		/* Pointer to entry in buftab	*/
+	bpid32	poolid;			/* ID of buffer's pool		*/
+
+	mask = disable();
+
+	/* Extract pool ID from integer prior to buffer address */
+
+	bufaddr -= BP_HDR;
+	poolid = *(bpid32 *)bufaddr;
+	if (poolid < 0  ||  poolid >= nbpools) {
+		restore(mask);
+		return SYSERR;
+	}
+	bpptr = &buftab[poolid];
+
+	/* Insert buffer into list and signal semaphore */
+
+	((struct bpentry *)bufaddr)->bpnext = bpptr->bpnext;
+	bpptr->bpnext = (struct bpentry *)bufaddr;
+	signal(bpptr->bpsem);
+	restore(mask);
+	return OK;
+}
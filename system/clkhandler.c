@@ -15,7 +15,6 @@
 /* clkhandler.c - clkhandler */
 
 #include <xinu.h>
-#include <usb_cdc_conf.h>
 /*-----------------------------------------------------------------------
  * clkhandler - high level clock interrupt handler
  *-----------------------------------------------------------------------
@@ -24,48 +23,120 @@
 //void __attribute__ ((naked)) clkhandler()
 
 
-extern	void	ttyhandler(uint32, char c, int tipo);
+extern	uint32_t SystemCoreClock;
 void TIM2_Handler()
 {   
+	uint32	ticks;			/* Ticks since last interrupt	*/
+
+		TIM2->SR &= ~(1U << 0);
+
+		/* After a tickless idle period go back to one tick per	*/
+		/*   interrupt and charge all elapsed ticks at once	*/
+
+		ticks = clkskip;
+		if (ticks > 1) {
+			TIM2->ARR = CLKTICK - 1;
+			clkskip = 1;
+			clkskipped += ticks - 1;
+		}
 
 		/* Increment 1000ms counter */
-	    TIM2->SR &= ~(1U << 0);
-        if(usb_available()){
-        	//kputc(usb_getc());
-        	//uint32 q = disable();
-        	ttyhandler(1,usb_getc(),0);
-        	//restore(q);
-        }
 
-		count1000++;
+		count1000 += ticks;
 
 		/* After 1 sec, increment clktime */
 
-		if(count1000 >= 1000) {
+		while(count1000 >= 1000) {
 			clktime++;
-			count1000 = 0;
+			count1000 -= 1000;
 
 		}
 
-		/* check if sleep queue is empty */
         if(ready_preemptive){
-			if(!isempty(sleepq)) {
-				/* sleepq nonempty, decrement the key of */
-				/* topmost process on sleepq		 */
 
-				if((--queuetab[firstid(sleepq)].qkey) == 0) {
+			/* Advance the timing wheel, waking every process	*/
+			/*   whose delay has run out				*/
 
-					wakeup();
-				}
-			}
+			tmadvance(ticks);
 
 			/* Decrement the preemption counter */
 			/* Reschedule if necessary	    */
 
-			if((--preempt) == 0) {
+			if(preempt <= ticks) {
 				preempt = QUANTUM;
 				// PendSV call
 				PEND_SV();
+			} else {
+				preempt -= ticks;
 			}
         }
 }
+
+/*------------------------------------------------------------------------
+ * clkidle - Called by the null process: stop the periodic tick until
+ *	     the timing wheel has work and wait for an interrupt
+ *------------------------------------------------------------------------
+ */
+void	clkidle(void)
+{
+	uint32	ticks;			/* Ticks to let pass		*/
+	uint32	next;			/* Ticks until wheel has work	*/
+	uint32	cnt;			/* TIM2 count on wakeup		*/
+	uint32	cnt0, arr0;		/* TIM2 count and reload at WFI	*/
+	uint32	slept;			/* TIM2 counts spent in WFI	*/
+	uint64	cycles;			/* Core cycles those counts span	*/
+
+	/* Mask with PRIMASK rather than disable(): an interrupt held	*/
+	/*   off by BASEPRI would not end the WFI below			*/
+
+	__disable_irq();
+
+	/* Keep ticking while someone else is ready			*/
+
+	ticks = 1;
+	if (TICKLESS && ready_preemptive && clkskip == 1
+	    && isempty(readylist)) {
+		next = tmnext();
+		ticks = (next < CLKMAXIDLE) ? next : CLKMAXIDLE;
+	}
+
+	/* The counter is part way through the current tick, so the	*/
+	/*   update event still comes on a tick boundary		*/
+
+	if (ticks > 1 && TIM2->CNT < CLKTICK - CLKMARGIN
+	    && !(TIM2->SR & TIM_SR_UIF)) {
+		TIM2->ARR = ticks * CLKTICK - 1;
+		clkskip = ticks;
+	}
+
+	cnt0 = TIM2->CNT;
+	arr0 = TIM2->ARR;
+	__DSB();
+	__WFI();			/* Any pending interrupt wakes	*/
+	clkwakeups++;
+
+	/* The core clock, and so DWT->CYCCNT, stops during WFI; charge	*/
+	/*   the time TIM2 saw to the null process instead		*/
+
+	cnt = TIM2->CNT;
+	slept = (cnt >= cnt0) ? cnt - cnt0 : cnt + arr0 + 1 - cnt0;
+	cycles = (uint64)slept * SystemCoreClock / (CLKTICK * 1000);
+	proctab[NULLPROC].prcycles += cycles;
+	cpucycles += cycles;
+
+	/* Woken early by another interrupt: end the idle period at the	*/
+	/*   next tick boundary so the clock handler catches up		*/
+
+	if (clkskip > 1 && !(TIM2->SR & TIM_SR_UIF)) {
+		cnt = TIM2->CNT;
+		ticks = cnt / CLKTICK + 1;
+		if (ticks * CLKTICK - cnt < CLKMARGIN) {
+			ticks++;
+		}
+		if (ticks < clkskip) {
+			TIM2->ARR = ticks * CLKTICK - 1;
+			clkskip = ticks;
+		}
+	}
+	__enable_irq();
+}
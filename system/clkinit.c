@@ -20,6 +20,9 @@ uint32	clktime;		/* Seconds since boot			*/
 uint32  count1000;              /* ms since last clock tick             */
 qid16	sleepq;			/* Queue of sleeping processes		*/
 uint32	preempt;		/* Preemption counter			*/
+uint32	clkskip;		/* Ticks covered by next interrupt	*/
+uint32	clkskipped;		/* Ticks that raised no interrupt	*/
+uint32	clkwakeups;		/* Times the null process left WFI	*/
 
 /*------------------------------------------------------------------------
  * clkinit  -  Initialize the clock and sleep queue at startup
@@ -30,15 +33,19 @@ void clkinit(void)
 	
 	 
 
-	sleepq = newqueue();	/* Allocate a queue to hold the delta	*/
-				/*   list of sleeping processes		*/
+	sleepq = newqueue();	/* Allocate the sleep queue ID that	*/
+				/*   insertd() maps to the wheel	*/
+	tminit();		/* Empty the timing wheel		*/
 	preempt = QUANTUM;	/* Set the preemption time		*/
 	clktime = 0;		/* Start counting seconds		*/
     count1000 = 0;
+	clkskip = 1;		/* Interrupt once per tick until idle	*/
+	clkskipped = 0;
+	clkwakeups = 0;
     RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
     TIM2->CR1 |= (1 << 2);
     TIM2->PSC = 0x7;
-    TIM2->ARR = 0x1000;
+    TIM2->ARR = CLKTICK - 1;
     TIM2->DIER |= 0x1;
     NVIC_DisableIRQ(TIM2_IRQn);
     //NVIC_EnableIRQ(TIM2_IRQn);
@@ -13,7 +13,7 @@ local	int newpid();
 pid32	create(
 	  void		*procaddr,	/* procedure address		*/
 	  uint32	ssize,		/* stack size in bytes		*/
-	  pri16		priority,	/* process priority > 0		*/
+	  pri16		priority,	/* priority, 1 to NRPRIO-1	*/
 	  char		*name,		/* name (for debugging)		*/
 	  uint32	nargs,		/* number of args that follow	*/
 	  ...
@@ -32,7 +32,8 @@ pid32	create(
 	ssize = (uint32) roundew(ssize);
 	if (((saddr = (uint32 *)getstk(ssize)) ==
 	    (uint32 *)SYSERR ) ||
-	    (pid=newpid()) == SYSERR || priority < 1 ) {
+	    (pid=newpid()) == SYSERR || priority < 1 ||
+	    priority >= NRPRIO ) {
 //		kprintf("create error %s\n",name);
 		restore(mask);
 		return SYSERR;
@@ -45,6 +46,10 @@ pid32	create(
 	/* initialize process table entry for new process */
 	prptr->prstate = PR_SUSP;	/* initial state is suspended	*/
 	prptr->prprio = priority;
+	prptr->prbprio = priority;
+	prptr->prmxheld = MX_NONE;
+	prptr->prmlist = NULL;
+	prptr->prheap = 0;
 	prptr->prstkbase = (char *)saddr;
 	prptr->prstklen = ssize;
 	prptr->prname[PNMLEN-1] = NULLCH;
@@ -53,6 +58,10 @@ pid32	create(
 	prptr->prsem = -1;
 	prptr->prparent = (pid32)getpid();
 	prptr->prhasmsg = FALSE;
+	prptr->prcycles = 0;
+	prptr->prbirth = cpucycles;
+	prptr->prctxsw = 0;
+	prptr->prstamp = DWT->CYCCNT;
 
 	/* set up initial device descriptors for the shell		*/
 	prptr->prdesc[0] = CONSOLE;	/* stdin  is CONSOLE device	*/
@@ -64,7 +73,7 @@ pid32	create(
 	uint32 * extraregs;
 	a = (uint32 *)(&nargs + 1);
 	tmpstk = ((uint32) saddr) - 0x1C;
-	extraregs = ((uint32) tmpstk) - 0x20; /* r4 - r11 */
+	extraregs = ((uint32) tmpstk) - 0x24; /* r4 - r11, EXC_RETURN */
 
 	for (int i = 0; i < nargs; i++) {
 		tmpstk[i] = (uint32) *a++;
@@ -78,6 +87,7 @@ pid32	create(
 	for (int i = 0; i <= 7; i++) {
 		extraregs[i] = 0x0; /* Initialize to zero */
 	}
+	extraregs[8] = INITEXCRET;	/* Start with a basic frame	*/
 	prptr->prstkptr = extraregs;
    
 	#if 0
@@ -133,6 +143,25 @@ local	pid32	newpid(void)
 
 
 
+/*------------------------------------------------------------------------
+ *  cpucharge  -  Charge the current process for the cycles it has run
+ *		  since it was last charged
+ *------------------------------------------------------------------------
+ */
+void	cpucharge(void)			/* Assumes interrupts disabled	*/
+{
+	struct	procent *prptr;		/* Ptr to current process entry	*/
+	uint32	now;			/* DWT cycle counter sample	*/
+	uint32	delta;			/* Cycles since the last charge	*/
+
+	prptr = &proctab[currpid];
+	now = DWT->CYCCNT;
+	delta = now - prptr->prstamp;	/* Correct across one wrap	*/
+	prptr->prcycles += delta;
+	prptr->prstamp = now;
+	cpucycles += delta;
+}
+
 /*------------------------------------------------------------------------
  *  getpid  -  Return the ID of the currently executing process
  *------------------------------------------------------------------------
@@ -143,12 +172,13 @@ pid32	getpid(void)
 }
 
 /*------------------------------------------------------------------------
- *  chprio  -  Change the scheduling priority of a process
+ *  chprio  -  Change the base scheduling priority of a process (it may
+ *		 run higher while it holds a mutex)
  *------------------------------------------------------------------------
  */
 pri16	chprio(
 	  pid32		pid,		/* ID of process to change	*/
-	  pri16		newprio		/* New priority			*/
+	  pri16		newprio		/* New priority, 1 to NRPRIO-1	*/
 	)
 {
 	intmask	mask;			/* Saved interrupt mask		*/
@@ -156,13 +186,14 @@ pri16	chprio(
 	pri16	oldprio;		/* Priority to return		*/
 
 	mask = disable();
-	if (isbadpid(pid)) {
+	if (isbadpid(pid) || newprio < 1 || newprio >= NRPRIO) {
 		restore(mask);
 		return (pri16) SYSERR;
 	}
 	prptr = &proctab[pid];
-	oldprio = prptr->prprio;
-	prptr->prprio = newprio;
+	oldprio = prptr->prbprio;
+	prptr->prbprio = newprio;
+	mxupdate(pid);			/* Requeue at the new priority	*/
 	restore(mask);
 	return oldprio;
 }
@@ -200,6 +231,10 @@ syscall	kill(
 	struct	procent *prptr;		/* Ptr to process's table entry	*/
 	int32	i;			/* Index into descriptors	*/
 
+	if (pid == currpid) {
+		fflush(stdout);		/* Exiting: write what is left	*/
+	}
+
 	mask = disable();
 	if (isbadpid(pid) || (pid == NULLPROC)
 	    || ((prptr = &proctab[pid])->prstate) == PR_FREE) {
@@ -216,9 +251,23 @@ syscall	kill(
 		close(prptr->prdesc[i]);
 	}
 	freestk(prptr->prstkbase, prptr->prstklen);
-    if(prptr->elf == TRUE){
-       free(prptr->img);
-    }
+	mxrelease(pid);			/* Hand held mutexes to waiters	*/
+
+	/* A loaded code image is freed with the process that runs it,	*/
+	/*   not with the one that loaded it: claim our own image and	*/
+	/*   hand any image we loaded for a live process over to it	*/
+
+	if (prptr->elf == TRUE) {
+		heapgive(prptr->img, pid);
+	}
+	for (i = 0; i < NPROC; i++) {
+		if (i != pid && proctab[i].prstate != PR_FREE
+		    && proctab[i].elf == TRUE) {
+			heapgive(proctab[i].img, i);
+		}
+	}
+	heapreclaim(pid);		/* Free what it malloc'ed	*/
+	bufdone(pid);			/* Drop its stdout buffer	*/
 	/*if(riscv1[pid].running){// si hay un vm activa
 	   riscv1[pid].running=0;
        #if use_ram == 1
@@ -231,7 +280,7 @@ syscall	kill(
 	switch (prptr->prstate) {
 	case PR_CURR:
 		prptr->prstate = PR_FREE;	/* Suicide */
-		PEND_SV();
+		resched();
 
 	case PR_SLEEP:
 	case PR_RECTIM:
@@ -239,6 +288,12 @@ syscall	kill(
 		prptr->prstate = PR_FREE;
 		break;
 
+	case PR_MUTEX:
+		getitem(pid);		/* Stop lending priority	*/
+		prptr->prstate = PR_FREE;
+		mxupdate(mxtab[prptr->prsem].mxowner);
+		break;
+
 	case PR_WAIT:
 		semtab[prptr->prsem].scount++;
 		/* Fall through */
@@ -265,27 +320,11 @@ syscall	yield(void)
 	intmask	mask;			/* Saved interrupt mask		*/
 
 	mask = disable();
-	PEND_SV();
+	resched();
 	restore(mask);
 	return OK;
 }
 
-/*------------------------------------------------------------------------
- *  wakeup  -  Called by clock interrupt handler to awaken processes
- *------------------------------------------------------------------------
- */
-void	wakeup(void)
-{
-	/* Awaken all processes that have no more time to sleep */
-	resched_cntl(DEFER_START);
-	while (nonempty(sleepq) && (firstkey(sleepq) <= 0)) {
-		ready(dequeue(sleepq));
-	}
-
-	resched_cntl(DEFER_STOP);
-	return;
-}
-
 /*------------------------------------------------------------------------
  *  wait  -  Cause current process to wait on a semaphore
  *------------------------------------------------------------------------
@@ -315,7 +354,7 @@ syscall	wait(
 		prptr->prstate = PR_WAIT;	/* Set state to waiting	*/
 		prptr->prsem = sem;		/* Record semaphore ID	*/
 		enqueue(currpid,semptr->squeue);/* Enqueue on semaphore	*/
-		PEND_SV();
+		resched();
 	}
 
 	restore(mask);
@@ -332,9 +371,8 @@ void	userret(void)
 }
 
 /*------------------------------------------------------------------------
- *  unsleep  -  Internal function to remove a process from the sleep
- *		    queue prematurely.  The caller must adjust the delay
- *		    of successive processes.
+ *  unsleep  -  Internal function to remove a process from the timing
+ *		    wheel prematurely
  *------------------------------------------------------------------------
  */
 status	unsleep(
@@ -344,10 +382,6 @@ status	unsleep(
 	intmask	mask;			/* Saved interrupt mask		*/
         struct	procent	*prptr;		/* Ptr to process's table entry	*/
 
-        pid32	pidnext;		/* ID of process on sleep queue	*/
-					/*   that follows the process	*/
-					/*   which is being removed	*/
-
 	mask = disable();
 
 	if (isbadpid(pid)) {
@@ -363,14 +397,7 @@ status	unsleep(
 		return SYSERR;
 	}
 
-	/* Increment delay of next process if such a process exists */
-
-	pidnext = queuetab[pid].qnext;
-	if (pidnext < NPROC) {
-		queuetab[pidnext].qkey += queuetab[pid].qkey;
-	}
-
-	getitem(pid);			/* Unlink process from queue */
+	tmremove(&slptab[pid]);		/* Cancel the wakeup */
 	restore(mask);
 	return OK;
 }
@@ -406,7 +433,7 @@ syscall	suspend(
 		prptr->prstate = PR_SUSP;
 	} else {
 		prptr->prstate = PR_SUSP;   /* Mark the current process	*/
-		PEND_SV();
+		resched();
 	}
 	prio = prptr->prprio;
 	restore(mask);
@@ -459,7 +486,7 @@ syscall	sleepms(
 	}
 
 	proctab[currpid].prstate = PR_SLEEP;
-	PEND_SV();	
+	resched();
 	
 	restore(mask);
 	return OK;
@@ -518,43 +545,61 @@ struct	defer	Defer;
  *
  * */
 
+/* The software frame below the hardware frame is r4-r11 followed by
+ * the EXC_RETURN value the process was interrupted with.  When bit 4
+ * of EXC_RETURN is clear the process has used the FPU, the hardware
+ * reserved an extended frame (s0-s15, FPSCR; filled lazily through
+ * FPCCR.LSPEN) and s16-s31 are saved above r4-r11.  Processes that
+ * never touch the FPU pay nothing extra per switch.
+ *
+ * */
+
+#define	CTXSAVE(sp)	asm volatile (					\
+		"mrs	r0, psp			\n\t"			\
+		"tst	lr, #0x10		\n\t"			\
+		"it	eq			\n\t"			\
+		"vstmdbeq r0!, {s16-s31}	\n\t"			\
+		"stmdb	r0!, {r4-r11, lr}	\n\t"			\
+		"mov	%0, r0" : "=r" (sp))
+
+#define	CTXRESTORE(sp)	asm volatile (					\
+		"mov	r0, %0			\n\t"			\
+		"ldmia	r0!, {r4-r11, lr}	\n\t"			\
+		"tst	lr, #0x10		\n\t"			\
+		"it	eq			\n\t"			\
+		"vldmiaeq r0!, {s16-s31}	\n\t"			\
+		"msr	psp, r0			\n\t"			\
+		"bx	lr" : : "r" (sp))
+
 void  __attribute__((naked)) PendSV_Handler(void){
 
 	uint32 * restorestk;
-	asm volatile("mrs r0, psp");
-	asm volatile("stmdb r0!, {r4-r11}");
-	asm volatile("mov %0, r0" : "=r" (restorestk)); // save tmp pointer
+	CTXSAVE(restorestk);		/* save tmp pointer */
 
 	struct procent *ptold;	/* Ptr to table entry for old process	*/
 	struct procent *ptnew;	/* Ptr to table entry for new process	*/
-	/* If rescheduling is deferred, record attempt and return */
 
+	/* Charge the cycles run so far, even if no switch follows, so	*/
+	/*   CYCCNT never wraps between two samples of one process	*/
 
+	cpucharge();
+
+	/* If rescheduling is deferred, record attempt and return */
 
 	if (Defer.ndefers > 0) {
 		Defer.attempt = TRUE;
-		asm volatile ("mov r0, %0" : : "r" (restorestk));
-		asm volatile("ldmia r0!, {r4-r11} ");
-		asm volatile ("msr psp, r0");
-		asm volatile (
-                	 "ldr r0, =0xFFFFFFFD" "\n\t"
-	                 "mov lr, r0" "\n\t"
-	                 "bx lr");
+		CTXRESTORE(restorestk);
 	}
 
+	wkwake();			/* Work posted above the ceiling */
+
 	/* Point to process table entry for the current (old) process */
 
 	ptold = &proctab[currpid];
 
 	if (ptold->prstate == PR_CURR) {  /* Process remains eligible */
 		if (ptold->prprio > firstkey(readylist)) {
-			asm volatile ("mov r0, %0" : : "r" (restorestk));
-			asm volatile("ldmia r0!, {r4-r11} ");
-			asm volatile ("msr psp, r0");
-		        asm volatile (
-                	 "ldr r0, =0xFFFFFFFD" "\n\t"
-	                 "mov lr, r0" "\n\t"
-	                 "bx lr");
+			CTXRESTORE(restorestk);
 		}
 
 		/* Old process will no longer remain current */
@@ -569,19 +614,46 @@ void  __attribute__((naked)) PendSV_Handler(void){
 	currpid = dequeue(readylist);
 	ptnew = &proctab[currpid];
 	ptnew->prstate = PR_CURR;
+	if (ptnew != ptold) {
+		ptnew->prstamp = ptold->prstamp; /* Starts running now	*/
+		ptnew->prctxsw++;
+	}
 	preempt = QUANTUM;		/* Reset time slice for process	*/
 
 
 	ptold->prstkptr = restorestk;
 	
 	/* Old process returns here when resumed */
-	asm volatile ("mov r0, %0" : : "r" (ptnew->prstkptr));
-	asm volatile("ldmia r0!, {r4-r11} ");
-	asm volatile ("msr psp, r0");
-        asm volatile (
-                 "ldr r0, =0xFFFFFFFD" "\n\t"
-                 "mov lr, r0" "\n\t"
-                 "bx lr");
+	CTXRESTORE(ptnew->prstkptr);
+}
+
+/*------------------------------------------------------------------------
+ *  resched  -  Switch away from the current process now, even from
+ *		inside a critical section (used by calls that block)
+ *------------------------------------------------------------------------
+ */
+void	resched(void)
+{
+	uint32	basepri;		/* Caller's interrupt mask	*/
+
+	/* PendSV is masked while BASEPRI is raised, so lower it just	*/
+	/*   long enough for the switch; the process comes back here	*/
+	/*   when it next runs and masks again				*/
+
+	basepri = __get_BASEPRI();
+	PEND_SV();
+#if INTRTRACE
+	if (basepri != 0) {
+		intrcheck((uint32)__builtin_return_address(0));
+	}
+#endif
+	__set_BASEPRI(0);
+	__DSB();
+	__ISB();
+	__set_BASEPRI(basepri);
+#if INTRTRACE
+	intrstart = DWT->CYCCNT;
+#endif
 }
 
 /*------------------------------------------------------------------------
@@ -142,6 +142,7 @@ syscall	getc(
 	struct dentry	*devptr;	/* Entry in device switch table	*/
 	int32		retval;		/* Value to return to caller	*/
 
+	fflush(stdout);			/* Show a prompt before waiting	*/
 	mask = disable();
 	if (isbaddev(descrp)) {
 		restore(mask);
@@ -231,6 +232,7 @@ syscall	read(
 	struct dentry	*devptr;	/* Entry in device switch table	*/
 	int32		retval;		/* Value to return to caller	*/
 	
+	fflush(stdout);			/* Show a prompt before waiting	*/
 	mask = disable();
 	if (isbaddev(descrp)) {
 		restore(mask);
@@ -38,11 +38,11 @@ extern int ready_preemptive;
 
 struct	procent	proctab[NPROC];	/* Process table			*/
 struct	sentry	semtab[NSEM];	/* Semaphore table			*/
-struct	memblk	memlist;	/* List of free memory blocks		*/
 
 /* Active system status */
 
 int	prcount;		/* Total number of live processes	*/
+uint64	cpucycles;		/* CPU cycles charged since boot	*/
 pid32	currpid;		/* ID of currently executing process	*/
 //bool start_null=false;
 /* Control sequence to reset the console colors and cusor positiion	*/
@@ -85,9 +85,40 @@ void blink1(){
 	}
 }
 
+/* The FAT library and the SD card behind it are shared by every	*/
+/*   process, so they are guarded by one priority inheritance mutex.	*/
+/*   The library takes its lock again from inside locked calls (e.g.	*/
+/*   fl_remove opens and closes the file), and a mutex is not		*/
+/*   recursive, so the owner counts its nested locks here and only	*/
+/*   the outermost unlock releases the mutex				*/
+
+local	int32	fatmutex;		/* Mutex serializing FAT access	*/
+local	int32	fatdepth;		/* Locks the owner holds	*/
+
+local	void	fatlock(void)
+{
+	if (mxtab[fatmutex].mxowner == currpid) {
+		fatdepth++;
+		return;
+	}
+	if (mxlock(fatmutex) == OK) {
+		fatdepth = 1;
+	}
+}
+
+local	void	fatunlock(void)
+{
+	if (mxtab[fatmutex].mxowner == currpid && --fatdepth == 0) {
+		mxunlock(fatmutex);
+	}
+}
+
 int  initFat32(){
 	uint32 size=sd_init();
     fl_init();
+	if ((fatmutex = mxcreate(0)) != SYSERR) {
+		fl_attach_locks(fatlock, fatunlock);
+	}
       // Attach media access functions to library
 	if (fl_attach_media(sd_readsector, sd_writesector) != FAT_INIT_OK)
 	{
@@ -118,7 +149,6 @@ int usbTask(){
 
 
 
-uint32 idleTicks;
 
 
 
@@ -205,8 +235,11 @@ int start_process(){
 int nullprocess(void) {
 
      syscall_init(&syscallp);
+	 resume(create(wkworker, WKSTK, WKPRIO, "workq", 0));
 	 resume(create(start_process, 4096, 50, "start", 1, 0));
-	 while(1);
+	 while(1) {
+		clkidle();	/* Sleep until an interrupt arrives	*/
+	 }
 	 return 0;
 }
 
@@ -214,13 +247,13 @@ int nullprocess(void) {
 
 void	nulluser()
 {	
-	struct	memblk	*memptr;	/* Ptr to memory block		*/
 	uint32	free_mem;		/* Total amount of free memory	*/
 
     hw_cfg_pin(GPIOx(GPIO_C),13,GPIOCFG_MODE_OUT | GPIOCFG_OSPEED_VHIGH  | GPIOCFG_OTYPE_PUPD | GPIOCFG_PUPD_PUP);
     hw_cfg_pin(GPIOx(GPIO_A),0,GPIOCFG_MODE_INP | GPIOCFG_OSPEED_VHIGH  | GPIOCFG_OTYPE_OPEN | GPIOCFG_PUPD_PUP);
 
     meminit();
+	wkinit();			/* USB interrupts post work	*/
 	platinit();
     /* Enable interrupts */
 	enable();
@@ -237,17 +270,11 @@ void	nulluser()
 	
     sysinit();
 	/* Output Xinu memory layout */
-	free_mem = 0;
-	for (memptr = memlist.mnext; memptr != NULL;
-						memptr = memptr->mnext) {
-		free_mem += memptr->mlength;
-	}
+	free_mem = heap_free();
 	kprintf ("Build date: %s %s\n\n", __DATE__, __TIME__);
-	kprintf("%10d bytes of free memory.  Free list:\n", free_mem);
-	for (memptr=memlist.mnext; memptr!=NULL;memptr = memptr->mnext) {
-	    kprintf("           [0x%08X to 0x%08X]\n",
-		(uint32)memptr, ((uint32)memptr) + memptr->mlength - 1);
-	}
+	kprintf("%10d bytes of free memory.  Heap:\n", free_mem);
+	kprintf("           [0x%08X to 0x%08X]\n",
+		(uint32)minheap, (uint32)maxheap - 1);
 
 	kprintf("%10d bytes of Xinu code.\n",
 		(uint32)&_etext - (uint32)&_text);
@@ -277,6 +304,7 @@ void	nulluser()
     asm volatile ("mov r0, %0\n" : : "r" (prptr->prstkptr));
 	asm volatile ("msr psp, r0");
 	asm volatile ("ldmia r0!, {r4-r11} ");
+	asm volatile ("add r0, r0, #4");	/* skip EXC_RETURN */
     asm volatile ("msr psp, r0");
 	asm volatile ("mov r0, #2");
 	asm volatile ("msr control, r0");
@@ -341,6 +369,10 @@ static	void	sysinit()
 		prptr->prname[0] = NULLCH;
 		prptr->prstkbase = NULL;
 		prptr->prprio = 0;
+		prptr->prbprio = 0;
+		prptr->prmxheld = MX_NONE;
+		prptr->prmlist = NULL;
+		prptr->prheap = 0;
 	}
 
 
@@ -353,8 +385,24 @@ static	void	sysinit()
 		semptr->squeue = newqueue();
 	}
 
+	/* Initialize mutexes */
+
+	for (i = 0; i < NMUTEX; i++) {
+		mxtab[i].mxstate = MX_FREE;
+		mxtab[i].mxowner = MX_NONE;
+		mxtab[i].mxqueue = newqueue();
+	}
+
+	/* Initialize the port table and message node pool */
+
+	ptinit(PT_MSGS);
+
+	/* Initialize the buffer pool table */
+
+	bufinit();
+
 	
-	readylist = newqueue();
+	readylist = newreadyq();
 
 	
 	for (i = 0; i < NDEVS; i++) {
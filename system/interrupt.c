@@ -34,4 +34,28 @@ void delay_us(uint32_t delay_us)
     start = DWT->CYCCNT;
     delay_us *= (SystemCoreClock / 1000000);
     while ((DWT->CYCCNT - start) < delay_us);
-}
\ No newline at end of file
+}
+
+#if INTRTRACE
+uint32	intrstart;			/* CYCCNT when masking began	*/
+uint32	intrmax;			/* Longest masked time seen	*/
+uint32	intrmaxpc;			/* Caller that ended it		*/
+
+/*------------------------------------------------------------------------
+ * intrcheck - Called by restore when a critical section ends; keep the
+ *	       longest one seen and where it ended
+ *------------------------------------------------------------------------
+ */
+void	intrcheck(
+	  uint32	pc		/* Return address in the caller	*/
+	)
+{
+	uint32	cycles;			/* Length of this section	*/
+
+	cycles = DWT->CYCCNT - intrstart;
+	if (cycles > intrmax) {
+		intrmax = cycles;
+		intrmaxpc = pc;
+	}
+}
+#endif
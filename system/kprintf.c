@@ -18,7 +18,7 @@ syscall kputc(
 	)
 {
 	intmask mask;
-	mask = disable();
+	mask = disableusb();		/* The USB handler uses the core too */
 	while(1){
       int len = usbd_ep_write(&udev, CDC_TXD_EP, &c, 1);
       if (len < 0){
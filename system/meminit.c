@@ -1,36 +1,68 @@
-/* meminit.c - meminit */
+/* meminit.c - meminit, freemem, getmem, getalign, resizemem, getstk,
+ *		heap_free, heapstat */
 
 #include <xinu.h>
 
 void	*minheap;	/* Start address of heap	*/
 void	*maxheap;	/* End address of heap		*/
+uint32	memfree;	/* Bytes in free heap blocks	*/
+
+local	uint32	memtotal;		/* Free bytes right after boot	*/
+local	uint32	memlow;			/* Fewest free bytes seen	*/
+local	uint32	memgets;		/* Successful getmem calls	*/
+local	uint32	memputs;		/* Successful freemem calls	*/
+local	uint32	memflmap;		/* Nonempty first levels	*/
+local	uint16	memslmap[MFLCOUNT];	/* Nonempty lists of each level	*/
+local	struct	memhdr	*memlists[MFLCOUNT][MSLCOUNT]; /* Free lists	*/
+
+local	void	mapsize(uint32, int32 *, int32 *);
+local	void	memlink(struct memhdr *);
+local	void	memunlink(struct memhdr *);
+local	void	memrelease(struct memhdr *);
+local	void	memtrim(struct memhdr *, uint32);
 
 /*------------------------------------------------------------------------
- * meminit - Initialize the free memory list for BeagleBone Black
+ * meminit - Initialize the heap as one free block and an end marker
  *------------------------------------------------------------------------
  */
 void	meminit(void)
 {
-	struct	memblk *memptr;	/* Memory block pointer	*/
+	struct	memhdr	*blk;		/* The initial free block	*/
+	struct	memhdr	*last;		/* Used block marking the end	*/
+	int32	i, j;			/* Index the free lists		*/
 
 	/* Initialize the minheap and maxheap variables */
 
-	minheap = (void *)&end;
+	minheap = (void *)roundmb(&end);
 	/* 1024 bytes is reserved for supervise mode handling */
 	maxheap = (void *)MAXADDR - HANDLERSTACK;
 
-	/* Initialize the memory list as one big block */
+	memflmap = 0;
+	for (i = 0; i < MFLCOUNT; i++) {
+		memslmap[i] = 0;
+		for (j = 0; j < MSLCOUNT; j++) {
+			memlists[i][j] = NULL;
+		}
+	}
 
-	memlist.mnext = (struct memblk *)minheap;
-	memptr = memlist.mnext;
+	/* A zero-size used block at the top stops coalescing there	*/
 
-	memptr->mnext = (struct memblk *)NULL;
-	memlist.mlength = memptr->mlength =
-		(uint32)maxheap - (uint32)minheap;
+	last = (struct memhdr *)truncmb((uint32)maxheap - MHDRSIZE);
+	blk = (struct memhdr *)minheap;
+	if ((uint32)last - (uint32)blk >= (1U << MFLMAX)) {
+		panic("meminit - heap too large for MFLMAX");
+	}
+	blk->msize = (uint32)last - (uint32)blk;
+	blk->mphys = NULL;
+	last->msize = MPFREE;
+	last->mphys = blk;
+
+	memfree = 0;
+	memlink(blk);
+	memtotal = memlow = memfree;
+	memgets = memputs = 0;
 }
 
-
-
 /*------------------------------------------------------------------------
  *  freemem  -  Free a memory block, returning the block to the free list
  *------------------------------------------------------------------------
@@ -41,108 +73,205 @@ syscall	freemem(
 	)
 {
 	intmask	mask;			/* Saved interrupt mask		*/
-	struct	memblk	*next, *prev, *block;
-	uint32	top;
+	struct	memhdr	*blk;		/* Header of the block		*/
+	uint32	size;			/* Size of the block		*/
 
 	mask = disable();
-	if ((nbytes == 0) || ((uint32) blkaddr < (uint32) minheap)
-			  || ((uint32) blkaddr > (uint32) maxheap)) {
+	if ((nbytes == 0) || ((uint32) blkaddr < (uint32) minheap + MHDRSIZE)
+			  || ((uint32) blkaddr > (uint32) maxheap)
+			  || ((uint32) blkaddr & 7) != 0) {
 		restore(mask);
 		return SYSERR;
 	}
 
-	nbytes = (uint32) roundmb(nbytes);	/* Use memblk multiples	*/
-	block = (struct memblk *)blkaddr;
+	/* The size must match the block, which may have absorbed a	*/
+	/*   remainder too small to split off when it was allocated	*/
 
-	prev = &memlist;			/* Walk along free list	*/
-	next = memlist.mnext;
-	while ((next != NULL) && (next < block)) {
-		prev = next;
-		next = next->mnext;
+	blk = (struct memhdr *)(blkaddr - MHDRSIZE);
+	size = mblksize(blk);
+	nbytes = (uint32) roundmb(nbytes) + MHDRSIZE;
+	if ((blk->msize & MFREE) || size < nbytes
+	    || size >= nbytes + MMINBLK) {
+		restore(mask);
+		return SYSERR;
 	}
 
-	if (prev == &memlist) {		/* Compute top of previous block*/
-		top = (uint32) NULL;
-	} else {
-		top = (uint32) prev + prev->mlength;
+	memrelease(blk);
+	memputs++;
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  getmem  -  Allocate heap storage, returning lowest word address
+ *------------------------------------------------------------------------
+ */
+char  	*getmem(
+	  uint32	nbytes		/* Size of memory requested	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	memhdr	*blk;		/* Block that is allocated	*/
+	uint32	size;			/* Block size needed		*/
+	uint32	round;			/* Size rounded up to its list	*/
+	uint32	map;			/* Candidate lists in a level	*/
+	int32	fl, sl;			/* Free list indices		*/
+
+	if (nbytes == 0 || nbytes >= (1U << MFLMAX)) {
+		return (char *)SYSERR;
+	}
+	size = (uint32) roundmb(nbytes) + MHDRSIZE;
+	if (size < MMINBLK) {
+		size = MMINBLK;
 	}
 
-	/* Ensure new block does not overlap previous or next blocks	*/
+	/* Round up to the next list boundary so that any block on the	*/
+	/*   list found is large enough (a good fit, not a search)	*/
 
-	if (((prev != &memlist) && (uint32) block < top)
-	    || ((next != NULL)	&& (uint32) block+nbytes>(uint32)next)) {
-		restore(mask);
-		return SYSERR;
+	round = size;
+	if (size >= (1U << MFLSHIFT)) {
+		round += (1U << (31 - __builtin_clz(size) - MSLBITS)) - 1;
 	}
+	mapsize(round, &fl, &sl);
 
-	memlist.mlength += nbytes;
+	mask = disable();
+	map = (fl < MFLCOUNT) ? memslmap[fl] & (~0U << sl) : 0;
+	if (map == 0) {				/* Try a higher level	*/
+		map = (fl + 1 < MFLCOUNT) ? memflmap & (~0U << (fl + 1)) : 0;
+		if (map != 0) {
+			fl = __builtin_ctz(map);
+			map = memslmap[fl];
+		}
+	}
+	if (map != 0) {
+		blk = memlists[fl][__builtin_ctz(map)];
+	} else {
+
+		/* Nothing larger is free, but the first block on the	*/
+		/*   request's own list may still be big enough		*/
+
+		mapsize(size, &fl, &sl);
+		blk = memlists[fl][sl];
+		if (blk == NULL || mblksize(blk) < size) {
+			restore(mask);
+			return (char *)SYSERR;
+		}
+	}
+	memunlink(blk);
+	mblknext(blk)->msize &= ~MPFREE;
+	memtrim(blk, size);
+	memgets++;
+	if (memfree < memlow) {
+		memlow = memfree;
+	}
+	restore(mask);
+	return (char *)blk + MHDRSIZE;
+}
 
-	/* Either coalesce with previous block or add to free list */
+/*------------------------------------------------------------------------
+ *  getalign  -  Allocate heap storage whose address is a multiple of a
+ *		   power of two (freed with freemem like any other block)
+ *------------------------------------------------------------------------
+ */
+char	*getalign(
+	  uint32	nbytes,		/* Size of memory requested	*/
+	  uint32	align		/* Required address alignment	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	memhdr	*blk;		/* Block that was allocated	*/
+	struct	memhdr	*hdr;		/* Header of the aligned block	*/
+	char	*addr;			/* Address getmem returned	*/
+	uint32	aligned;		/* First usable aligned address	*/
 
-	if (top == (uint32) block) { 	/* Coalesce with previous block	*/
-		prev->mlength += nbytes;
-		block = prev;
-	} else {			/* Link into list as new node	*/
-		block->mnext = next;
-		block->mlength = nbytes;
-		prev->mnext = block;
+	if (align <= 8) {
+		return getmem(nbytes);
+	}
+	if (nbytes == 0 || (align & (align - 1)) != 0
+	    || nbytes + align + MMINBLK >= (1U << MFLMAX)) {
+		return (char *)SYSERR;
 	}
 
-	/* Coalesce with next block if adjacent */
+	/* Over-allocate so an aligned address leaves room for a free	*/
+	/*   block in front of it, then give back the head and tail	*/
 
-	if (((uint32) block + block->mlength) == (uint32) next) {
-		block->mlength += next->mlength;
-		block->mnext = next->mnext;
+	addr = getmem(nbytes + align + MMINBLK);
+	if (addr == (char *)SYSERR) {
+		return (char *)SYSERR;
 	}
+	mask = disable();
+	blk = (struct memhdr *)(addr - MHDRSIZE);
+	if (((uint32)addr & (align - 1)) != 0) {
+		aligned = ((uint32)addr + MMINBLK + align - 1) & ~(align - 1);
+		hdr = (struct memhdr *)(aligned - MHDRSIZE);
+		hdr->msize = mblksize(blk) - ((uint32)hdr - (uint32)blk);
+		hdr->mphys = blk;
+		mblknext(hdr)->mphys = hdr;
+		blk->msize = ((uint32)hdr - (uint32)blk)
+				| (blk->msize & MPFREE);
+		memrelease(blk);
+		blk = hdr;
+	}
+	memtrim(blk, (uint32) roundmb(nbytes) + MHDRSIZE);
 	restore(mask);
-	return OK;
+	return (char *)blk + MHDRSIZE;
 }
 
 /*------------------------------------------------------------------------
- *  getmem  -  Allocate heap storage, returning lowest word address
+ *  resizemem  -  Shrink or grow a block from getmem without moving it,
+ *		    returning SYSERR if the block cannot grow in place
  *------------------------------------------------------------------------
  */
-char  	*getmem(
-	  uint32	nbytes		/* Size of memory requested	*/
+syscall	resizemem(
+	  char		*blkaddr,	/* Pointer to memory block	*/
+	  uint32	oldbytes,	/* Size it was allocated with	*/
+	  uint32	newbytes	/* Size it should have		*/
 	)
 {
 	intmask	mask;			/* Saved interrupt mask		*/
-	struct	memblk	*prev, *curr, *leftover;
+	struct	memhdr	*blk;		/* Header of the block		*/
+	struct	memhdr	*next;		/* Block physically after it	*/
+	uint32	size;			/* Size of the block		*/
 
 	mask = disable();
-	if (nbytes == 0) {
+	if ((oldbytes == 0) || (newbytes == 0)
+			    || (newbytes >= (1U << MFLMAX))
+			    || ((uint32) blkaddr < (uint32) minheap + MHDRSIZE)
+			    || ((uint32) blkaddr > (uint32) maxheap)
+			    || ((uint32) blkaddr & 7) != 0) {
 		restore(mask);
-		return (char *)SYSERR;
+		return SYSERR;
+	}
+	blk = (struct memhdr *)(blkaddr - MHDRSIZE);
+	size = mblksize(blk);
+	oldbytes = (uint32) roundmb(oldbytes) + MHDRSIZE;
+	if ((blk->msize & MFREE) || size < oldbytes
+	    || size >= oldbytes + MMINBLK) {
+		restore(mask);
+		return SYSERR;
 	}
 
-	nbytes = (uint32) roundmb(nbytes);	/* Use memblk multiples	*/
-
-	prev = &memlist;
-	curr = memlist.mnext;
-	while (curr != NULL) {			/* Search free list	*/
+	/* To grow, absorb the free block that follows if it is big	*/
+	/*   enough; then give back whatever is beyond the new size	*/
 
-		if (curr->mlength == nbytes) {	/* Block is exact match	*/
-			prev->mnext = curr->mnext;
-			memlist.mlength -= nbytes;
+	newbytes = (uint32) roundmb(newbytes) + MHDRSIZE;
+	if (newbytes > size) {
+		next = mblknext(blk);
+		if (!(next->msize & MFREE)
+		    || size + mblksize(next) < newbytes) {
 			restore(mask);
-			return (char *)(curr);
-
-		} else if (curr->mlength > nbytes) { /* Split big block	*/
-			leftover = (struct memblk *)((uint32) curr +
-					nbytes);
-			prev->mnext = leftover;
-			leftover->mnext = curr->mnext;
-			leftover->mlength = curr->mlength - nbytes;
-			memlist.mlength -= nbytes;
-			restore(mask);
-			return (char *)(curr);
-		} else {			/* Move to next block	*/
-			prev = curr;
-			curr = curr->mnext;
+			return SYSERR;
 		}
+		memunlink(next);
+		blk->msize += mblksize(next);
+		mblknext(blk)->msize &= ~MPFREE;
+	}
+	memtrim(blk, newbytes);
+	if (memfree < memlow) {
+		memlow = memfree;
 	}
 	restore(mask);
-	return (char *)SYSERR;
+	return OK;
 }
 
 /*------------------------------------------------------------------------
@@ -153,53 +282,205 @@ char  	*getstk(
 	  uint32	nbytes		/* Size of memory requested	*/
 	)
 {
-	intmask	mask;			/* Saved interrupt mask		*/
-	struct	memblk	*prev, *curr;	/* Walk through memory list	*/
-	struct	memblk	*fits, *fitsprev; /* Record block that fits	*/
+	char	*blkaddr;		/* Lowest address of the stack	*/
 
-	mask = disable();
-	if (nbytes == 0) {
-		restore(mask);
+	nbytes = (uint32) roundmb(nbytes);	/* Use mblock multiples	*/
+	if ((blkaddr = getmem(nbytes)) == (char *)SYSERR) {
 		return (char *)SYSERR;
 	}
+	return blkaddr + nbytes - sizeof(uint32);
+}
 
-	nbytes = (uint32) roundmb(nbytes);	/* Use mblock multiples	*/
+/*------------------------------------------------------------------------
+ *  heap_free  -  Return the number of bytes in free heap blocks
+ *------------------------------------------------------------------------
+ */
+uint32	heap_free(void)
+{
+	return memfree;
+}
+
+/*------------------------------------------------------------------------
+ *  heapstat  -  Fill in a snapshot of heap use and fragmentation
+ *------------------------------------------------------------------------
+ */
+syscall	heapstat(
+	  struct memstat *msptr		/* Where to store the snapshot	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	memhdr	*blk;		/* Walks a free list		*/
+	uint32	largest;		/* Largest free block size	*/
+	int32	fl, sl;			/* Free list indices		*/
+
+	if (msptr == NULL) {
+		return SYSERR;
+	}
+	for (fl = 0; fl < MFLCOUNT; fl++) {
+		msptr->mhist[fl] = 0;
+	}
+	msptr->mnfree = 0;
+	largest = 0;
 
-	prev = &memlist;
-	curr = memlist.mnext;
-	fits = NULL;
-	fitsprev = NULL;  /* Just to avoid a compiler warning */
+	/* The free lists hold only free blocks, so walking them is	*/
+	/*   cheaper than walking the whole heap			*/
 
-	while (curr != NULL) {			/* Scan entire list	*/
-		if (curr->mlength >= nbytes) {	/* Record block address	*/
-			fits = curr;		/*   when request fits	*/
-			fitsprev = prev;
+	mask = disable();
+	for (fl = 0; fl < MFLCOUNT; fl++) {
+		if ((memflmap & (1U << fl)) == 0) {
+			continue;
+		}
+		for (sl = 0; sl < MSLCOUNT; sl++) {
+			for (blk = memlists[fl][sl]; blk != NULL;
+						blk = blk->mnextfree) {
+				msptr->mhist[fl]++;
+				msptr->mnfree++;
+				if (mblksize(blk) > largest) {
+					largest = mblksize(blk);
+				}
+			}
 		}
-		prev = curr;
-		curr = curr->mnext;
 	}
+	msptr->mtotal = memtotal;
+	msptr->mfree = memfree;
+	msptr->mpeak = memtotal - memlow;
+	msptr->mgets = memgets;
+	msptr->mputs = memputs;
+	msptr->mtime = tmnow;
+	restore(mask);
 
-	if (fits == NULL) {			/* No block was found	*/
-		restore(mask);
-		return (char *)SYSERR;
+	/* Fragmentation is the share of free memory that lies outside	*/
+	/*   the largest block: 0 for one free block, near 1000 when	*/
+	/*   free memory is scattered in small pieces			*/
+
+	msptr->mlargest = (largest > MHDRSIZE) ? largest - MHDRSIZE : 0;
+	msptr->mfrag = (msptr->mfree == 0) ? 0
+		: 1000 - largest * 1000 / msptr->mfree;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  memrelease  -  Free a used block, coalescing it with free neighbors
+ *------------------------------------------------------------------------
+ */
+local	void	memrelease(			/* Assumes interrupts disabled	*/
+	  struct memhdr	*blk		/* Block to free		*/
+	)
+{
+	struct	memhdr	*next;		/* Block physically after blk	*/
+	struct	memhdr	*prev;		/* Block physically before blk	*/
+	uint32	size;			/* Size of the coalesced block	*/
+
+	size = mblksize(blk);
+	next = mblknext(blk);
+	if (next->msize & MFREE) {
+		memunlink(next);
+		size += mblksize(next);
 	}
-	if (nbytes == fits->mlength) {		/* Block is exact match	*/
-		fitsprev->mnext = fits->mnext;
-	} else {				/* Remove top section	*/
-		fits->mlength -= nbytes;
-		fits = (struct memblk *)((uint32)fits + fits->mlength);
+	if (blk->msize & MPFREE) {
+		prev = blk->mphys;
+		memunlink(prev);
+		size += mblksize(prev);
+		blk = prev;
+	}
+	blk->msize = size | (blk->msize & MPFREE);
+	memlink(blk);
+}
+
+/*------------------------------------------------------------------------
+ *  memtrim  -  Shrink a used block to a size, freeing the tail if it is
+ *		  big enough to be a block of its own
+ *------------------------------------------------------------------------
+ */
+local	void	memtrim(			/* Assumes interrupts disabled	*/
+	  struct memhdr	*blk,		/* Used block to shrink		*/
+	  uint32	size		/* New size including header	*/
+	)
+{
+	struct	memhdr	*rest;		/* Tail that is split off	*/
+
+	if (mblksize(blk) - size < MMINBLK) {
+		return;
+	}
+	rest = (struct memhdr *)((char *)blk + size);
+	rest->msize = mblksize(blk) - size;
+	rest->mphys = blk;
+	mblknext(rest)->mphys = rest;
+	blk->msize = size | (blk->msize & MPFREE);
+	memrelease(rest);
+}
+
+/*------------------------------------------------------------------------
+ *  mapsize  -  Find the free list that holds blocks of a given size
+ *------------------------------------------------------------------------
+ */
+local	void	mapsize(
+	  uint32	size,		/* Block size including header	*/
+	  int32		*fl,		/* First level index returned	*/
+	  int32		*sl		/* Second level index returned	*/
+	)
+{
+	int32	msb;			/* Highest bit set in size	*/
+
+	if (size < (1U << MFLSHIFT)) {
+		*fl = 0;
+		*sl = size >> 3;
+	} else {
+		msb = 31 - __builtin_clz(size);
+		*fl = msb - MFLSHIFT + 1;
+		*sl = (size >> (msb - MSLBITS)) & (MSLCOUNT - 1);
 	}
-	memlist.mlength -= nbytes;
-	restore(mask);
-	return (char *)((uint32) fits + nbytes - sizeof(uint32));
 }
 
-uint32 heap_free(){
-  struct  memblk  *memptr;  /* Ptr to memory block    */
-  uint32  free_mem;   /* Total amount of free memory  */
-  free_mem = 0;
-  for (memptr = memlist.mnext; memptr != NULL; memptr = memptr->mnext) {
-       free_mem += memptr->mlength;
-  }
-  return free_mem;
+/*------------------------------------------------------------------------
+ *  memlink  -  Mark a block free and put it at the head of its list
+ *------------------------------------------------------------------------
+ */
+local	void	memlink(			/* Assumes interrupts disabled	*/
+	  struct memhdr	*blk		/* Block to insert		*/
+	)
+{
+	struct	memhdr	*next;		/* Block physically after blk	*/
+	int32	fl, sl;			/* Free list indices		*/
+
+	mapsize(mblksize(blk), &fl, &sl);
+	blk->msize |= MFREE;
+	blk->mprevfree = NULL;
+	if ((blk->mnextfree = memlists[fl][sl]) != NULL) {
+		blk->mnextfree->mprevfree = blk;
+	}
+	memlists[fl][sl] = blk;
+	memslmap[fl] |= 1U << sl;
+	memflmap |= 1U << fl;
+
+	next = mblknext(blk);
+	next->msize |= MPFREE;
+	next->mphys = blk;
+	memfree += mblksize(blk);
+}
+
+/*------------------------------------------------------------------------
+ *  memunlink  -  Remove a block from its free list and mark it used
+ *------------------------------------------------------------------------
+ */
+local	void	memunlink(			/* Assumes interrupts disabled	*/
+	  struct memhdr	*blk		/* Block to remove		*/
+	)
+{
+	int32	fl, sl;			/* Free list indices		*/
+
+	mapsize(mblksize(blk), &fl, &sl);
+	if (blk->mnextfree != NULL) {
+		blk->mnextfree->mprevfree = blk->mprevfree;
+	}
+	if (blk->mprevfree != NULL) {
+		blk->mprevfree->mnextfree = blk->mnextfree;
+	} else if ((memlists[fl][sl] = blk->mnextfree) == NULL) {
+		memslmap[fl] &= ~(1U << sl);
+		if (memslmap[fl] == 0) {
+			memflmap &= ~(1U << fl);
+		}
+	}
+	blk->msize &= ~MFREE;
+	memfree -= mblksize(blk);
 }
@@ -16,7 +16,7 @@ umsg32	receive(void)
 	prptr = &proctab[currpid];
 	if (prptr->prhasmsg == FALSE) {
 		prptr->prstate = PR_RECV;
-		PEND_SV();
+		resched();
 	}
 	msg = prptr->prmsg;		/* Retrieve message		*/
 	prptr->prhasmsg = FALSE;	/* Reset message flag		*/
@@ -72,8 +72,7 @@ umsg32	recvtime(
 			return SYSERR;
 		}
 		prptr->prstate = PR_RECTIM;
-		PEND_SV();
-		//resched();
+		resched();
 	}
 
 	/* Either message arrived or timer expired */
@@ -0,0 +1,297 @@
+/* mutex.c - mxcreate, mxdelete, mxlock, mxunlock, mxupdate, mxrelease */
+
+#include <xinu.h>
+
+struct	mxentry	mxtab[NMUTEX];		/* Mutex table			*/
+
+local	void	mxtake(int32, pid32);
+local	void	mxdrop(int32);
+local	void	mxpass(int32);
+
+/*------------------------------------------------------------------------
+ *  mxcreate  -  Create a mutex; a nonzero ceiling raises each owner to
+ *		   that priority for as long as it holds the mutex
+ *------------------------------------------------------------------------
+ */
+int32	mxcreate(
+	  pri16		ceiling		/* Ceiling priority or 0	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	static	int32	nextmx = 0;	/* Next mutex index to try	*/
+	int32	mx;			/* Mutex ID to return		*/
+	int32	i;			/* Iterate through # entries	*/
+
+	if (ceiling < 0 || ceiling >= NRPRIO) {
+		return SYSERR;
+	}
+	mask = disable();
+	for (i=0 ; i<NMUTEX ; i++) {
+		mx = nextmx++;
+		if (nextmx >= NMUTEX) {
+			nextmx = 0;
+		}
+		if (mxtab[mx].mxstate == MX_FREE) {
+			mxtab[mx].mxstate = MX_USED;
+			mxtab[mx].mxowner = MX_NONE;
+			mxtab[mx].mxceil = ceiling;
+			restore(mask);
+			return mx;
+		}
+	}
+	restore(mask);
+	return SYSERR;
+}
+
+/*------------------------------------------------------------------------
+ *  mxdelete  -  Delete a mutex, releasing its owner and any waiting
+ *		   processes (whose mxlock calls return SYSERR)
+ *------------------------------------------------------------------------
+ */
+syscall	mxdelete(
+	  int32		mx		/* ID of mutex to delete	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	mxentry	*mxptr;		/* Ptr to mutex table entry	*/
+	pid32	owner;			/* Process that held the mutex	*/
+	pid32	pid;			/* Waiting process to release	*/
+
+	mask = disable();
+	if (isbadmutex(mx) || (mxptr = &mxtab[mx])->mxstate == MX_FREE) {
+		restore(mask);
+		return SYSERR;
+	}
+	mxptr->mxstate = MX_FREE;
+
+	resched_cntl(DEFER_START);
+	if ((owner = mxptr->mxowner) != MX_NONE) {
+		mxdrop(mx);
+		mxptr->mxowner = MX_NONE;
+		mxupdate(owner);
+	}
+	while (nonempty(mxptr->mxqueue)) {
+		pid = getfirst(mxptr->mxqueue);
+		proctab[pid].prsem = -1;
+		ready(pid);
+	}
+	resched_cntl(DEFER_STOP);
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  mxlock  -  Lock a mutex, lending the caller's priority to the owner
+ *		 while the caller waits for it
+ *------------------------------------------------------------------------
+ */
+syscall	mxlock(
+	  int32		mx		/* ID of mutex to lock		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	mxentry	*mxptr;		/* Ptr to mutex table entry	*/
+	struct	procent	*prptr;		/* Ptr to caller's table entry	*/
+
+	mask = disable();
+	if (isbadmutex(mx) || (mxptr = &mxtab[mx])->mxstate == MX_FREE) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	/* A mutex is not recursive, and under a ceiling no process	*/
+	/*   may lock it from a base priority above the ceiling		*/
+
+	prptr = &proctab[currpid];
+	if (mxptr->mxowner == currpid
+	    || (mxptr->mxceil != 0 && prptr->prbprio > mxptr->mxceil)) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	if (mxptr->mxowner == MX_NONE) {
+		mxtake(mx, currpid);
+		restore(mask);
+		return OK;
+	}
+
+	/* Wait in priority order and raise the chain of owners	*/
+
+	prptr->prstate = PR_MUTEX;
+	prptr->prsem = mx;
+	insert(currpid, mxptr->mxqueue, prptr->prprio);
+	mxupdate(mxptr->mxowner);
+	resched();
+
+	/* mxunlock hands the mutex over; mxdelete does not		*/
+
+	if (mxptr->mxowner != currpid) {
+		restore(mask);
+		return SYSERR;
+	}
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  mxunlock  -  Unlock a mutex held by the caller, handing it to the
+ *		   highest priority waiting process
+ *------------------------------------------------------------------------
+ */
+syscall	mxunlock(
+	  int32		mx		/* ID of mutex to unlock	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	mxentry	*mxptr;		/* Ptr to mutex table entry	*/
+
+	mask = disable();
+	if (isbadmutex(mx) || (mxptr = &mxtab[mx])->mxstate == MX_FREE
+	    || mxptr->mxowner != currpid) {
+		restore(mask);
+		return SYSERR;
+	}
+	resched_cntl(DEFER_START);
+	mxpass(mx);
+	mxupdate(currpid);		/* Give up borrowed priority	*/
+	resched_cntl(DEFER_STOP);
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  mxupdate  -  Recompute the priority of a process from its base
+ *		   priority and the mutexes it holds, move it within the
+ *		   queue it is on, and pass the change along the chain of
+ *		   owners it may be waiting behind
+ *------------------------------------------------------------------------
+ */
+void	mxupdate(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of process to update	*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process's table entry	*/
+	struct	mxentry	*mxptr;		/* Walks the held mutexes	*/
+	int32	mx;			/* ID of a held mutex		*/
+	pri16	prio;			/* New effective priority	*/
+	pri16	oldprio;		/* Effective priority before	*/
+	int32	hops;			/* Bounds a deadlocked chain	*/
+
+	for (hops = 0; hops < NPROC && !isbadpid(pid); hops++) {
+		prptr = &proctab[pid];
+		prio = prptr->prbprio;
+		for (mx = prptr->prmxheld; mx != MX_NONE; mx = mxptr->mxnext) {
+			mxptr = &mxtab[mx];
+			if (mxptr->mxceil > prio) {
+				prio = mxptr->mxceil;
+			}
+			if (nonempty(mxptr->mxqueue)
+			    && firstkey(mxptr->mxqueue) > prio) {
+				prio = firstkey(mxptr->mxqueue);
+			}
+		}
+		if ((oldprio = prptr->prprio) == prio) {
+			return;
+		}
+		prptr->prprio = prio;
+
+		switch (prptr->prstate) {
+		case PR_READY:		/* Move to its new ready level	*/
+			getitem(pid);
+			insert(pid, readylist, prio);
+			if (prio > oldprio) {
+				PEND_SV();
+			}
+			return;
+
+		case PR_CURR:		/* May no longer be the highest	*/
+			if (prio < oldprio) {
+				PEND_SV();
+			}
+			return;
+
+		case PR_MUTEX:		/* Reorder and lend to owner	*/
+			mxptr = &mxtab[prptr->prsem];
+			getitem(pid);
+			insert(pid, mxptr->mxqueue, prio);
+			pid = mxptr->mxowner;
+			continue;
+
+		default:
+			return;
+		}
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  mxrelease  -  Hand every mutex a process holds to its next waiter
+ *		    (used when the process is killed)
+ *------------------------------------------------------------------------
+ */
+void	mxrelease(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of process being killed	*/
+	)
+{
+	while (proctab[pid].prmxheld != MX_NONE) {
+		mxpass(proctab[pid].prmxheld);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  mxtake  -  Make a process the owner of a free mutex
+ *------------------------------------------------------------------------
+ */
+local	void	mxtake(
+	  int32		mx,		/* ID of mutex to take		*/
+	  pid32		pid		/* ID of the new owner		*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to owner's table entry	*/
+
+	prptr = &proctab[pid];
+	mxtab[mx].mxowner = pid;
+	mxtab[mx].mxnext = prptr->prmxheld;
+	prptr->prmxheld = mx;
+	mxupdate(pid);			/* Apply ceiling and waiters	*/
+}
+
+/*------------------------------------------------------------------------
+ *  mxdrop  -  Unlink a mutex from its owner's list of held mutexes
+ *------------------------------------------------------------------------
+ */
+local	void	mxdrop(
+	  int32		mx		/* ID of mutex to unlink	*/
+	)
+{
+	int32	*link;			/* Field that points at mx	*/
+
+	link = &proctab[mxtab[mx].mxowner].prmxheld;
+	while (*link != mx) {
+		link = &mxtab[*link].mxnext;
+	}
+	*link = mxtab[mx].mxnext;
+}
+
+/*------------------------------------------------------------------------
+ *  mxpass  -  Take a mutex from its owner and give it to the highest
+ *		 priority waiting process, if there is one
+ *------------------------------------------------------------------------
+ */
+local	void	mxpass(
+	  int32		mx		/* ID of mutex to pass on	*/
+	)
+{
+	struct	mxentry	*mxptr;		/* Ptr to mutex table entry	*/
+	pid32	pid;			/* Waiter that gets the mutex	*/
+
+	mxptr = &mxtab[mx];
+	mxdrop(mx);
+	if (isempty(mxptr->mxqueue)) {
+		mxptr->mxowner = MX_NONE;
+		return;
+	}
+	pid = getfirst(mxptr->mxqueue);
+	proctab[pid].prsem = -1;
+	ready(pid);
+	mxtake(mx, pid);
+}
@@ -25,6 +25,15 @@
  */
 void platinit(void)
 {
+	/* Assign priorities before any interrupt is enabled; see	*/
+	/*   irqprio.h for which handlers run above the kernel ceiling	*/
+
+	NVIC_SetPriority(SysTick_IRQn, IRQ_SYSTICK);
+	NVIC_SetPriority(OTG_FS_IRQn, IRQ_USB);
+	NVIC_SetPriority(SVCall_IRQn, IRQ_SVC);
+	NVIC_SetPriority(TIM2_IRQn, IRQ_CLOCK);
+	NVIC_SetPriority(PendSV_IRQn, IRQ_PENDSV);
+
 	//hal_w25q_spi_init();
     //SPI_Flash_Init();
     RCC->AHB2ENR |= RCC_AHB2ENR_OTGFSEN;
@@ -0,0 +1,324 @@
+/* ports.c - ptinit, ptcreate, ptsend, ptrecv, ptcount, ptdelete, ptreset */
+
+#include <xinu.h>
+
+struct	ptnode	*ptfree;		/* List of free message nodes	*/
+struct	ptentry	porttab[NPORTS];	/* Port table			*/
+int32	ptnextid;			/* Next table entry to try	*/
+
+local	int32	ptspare;		/* Free nodes no port can claim	*/
+
+local	void	_ptclear(struct ptentry *, uint16, int32 (*)(int32));
+
+/*------------------------------------------------------------------------
+ *  ptinit  -  Initialize all ports
+ *------------------------------------------------------------------------
+ */
+syscall	ptinit(
+	  int32	maxmsgs			/* Total messages in all ports	*/
+	)
+{
+	int32	i;			/* Runs through the port table	*/
+	struct	ptnode	*next, *curr;	/* Used to build a free list	*/
+
+	ptfree = (struct ptnode *)getmem(maxmsgs*sizeof(struct ptnode));
+	if (ptfree == (struct ptnode *)SYSERR) {
+		panic("ptinit - insufficient memory");
+	}
+
+	/* Initialize all port table entries to free */
+
+	for (i=0 ; i<NPORTS ; i++) {
+		porttab[i].ptstate = PT_FREE;
+		porttab[i].ptseq = 0;
+	}
+	ptnextid = 0;
+
+	/* Create a free list of message nodes linked together */
+
+	for ( curr=next=ptfree ;  --maxmsgs > 0  ; curr=next ) {
+		curr->ptnext = ++next;
+	}
+
+	/* Set the pointer in the final node to NULL */
+
+	curr->ptnext = NULL;
+	ptspare = next - ptfree + 1;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  ptcreate  -  Create a port that allows "count" outstanding messages
+ *------------------------------------------------------------------------
+ */
+syscall	ptcreate(
+	  int32		count		/* Size of port			*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	i;			/* Counts all possible ports	*/
+	int32	ptnum;			/* Candidate port number to try	*/
+	struct	ptentry	*ptptr;		/* Pointer to port table entry	*/
+
+	mask = disable();
+
+	/* Each port holds nodes for its full depth, so a sender that	*/
+	/*   passes the semaphore always finds a free node		*/
+
+	if (count <= 0 || count > ptspare) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	for (i=0 ; i<NPORTS ; i++) {	/* Count all table entries	*/
+		ptnum = ptnextid;	/* Get an entry to check	*/
+		if (++ptnextid >= NPORTS) {
+			ptnextid = 0;	/* Reset for next iteration	*/
+		}
+
+		/* Check table entry that corresponds to ID ptnum */
+
+		ptptr= &porttab[ptnum];
+		if (ptptr->ptstate != PT_FREE) {
+			continue;
+		}
+		if ((ptptr->ptssem = semcreate(count)) == SYSERR) {
+			break;
+		}
+		if ((ptptr->ptrsem = semcreate(0)) == SYSERR) {
+			semdelete(ptptr->ptssem);
+			break;
+		}
+		ptptr->ptstate = PT_ALLOC;
+		ptptr->pthead = ptptr->pttail = NULL;
+		ptptr->ptseq++;
+		ptptr->ptmaxcnt = count;
+		ptspare -= count;
+		restore(mask);
+		return ptnum;
+	}
+	restore(mask);
+	return SYSERR;
+}
+
+/*------------------------------------------------------------------------
+ *  ptsend  -  Send a message to a port by adding it to the queue
+ *------------------------------------------------------------------------
+ */
+syscall	ptsend(
+	  int32		portid,		/* ID of port to use		*/
+	  umsg32	msg		/* Message to send		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	ptentry	*ptptr;		/* Pointer to table entry	*/
+	int32	seq;			/* Local copy of sequence num.	*/
+	struct	ptnode	*msgnode;	/* Allocated message node 	*/
+	struct	ptnode	*tailnode;	/* Last node in port or NULL	*/
+
+	mask = disable();
+	if ( isbadport(portid) ||
+	     (ptptr= &porttab[portid])->ptstate != PT_ALLOC ) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	/* Wait for space and verify port has not been reset */
+
+	seq = ptptr->ptseq;		/* Record original sequence	*/
+	if (wait(ptptr->ptssem) == SYSERR || ptptr->ptstate != PT_ALLOC
+	    || ptptr->ptseq != seq) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	/* Obtain node from free list by unlinking */
+
+	msgnode = ptfree;		/* Point to first free node	*/
+	ptfree  = msgnode->ptnext;	/* Unlink from the free list	*/
+	msgnode->ptnext = NULL;		/* Set fields in the node	*/
+	msgnode->ptmsg  = msg;
+
+	/* Link into queue for the specified port */
+
+	tailnode = ptptr->pttail;
+	if (tailnode == NULL) {		/* Queue for port was empty	*/
+		ptptr->pttail = ptptr->pthead = msgnode;
+	} else {			/* Insert new node at tail	*/
+		tailnode->ptnext = msgnode;
+		ptptr->pttail = msgnode;
+	}
+	signal(ptptr->ptrsem);
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  ptrecv  -  Receive a message from a port, blocking if port empty
+ *------------------------------------------------------------------------
+ */
+uint32	ptrecv(
+	  int32		portid		/* ID of port to use		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	seq;			/* Local copy of sequence num.	*/
+	umsg32	msg;			/* Message to return		*/
+	struct	ptentry	*ptptr;		/* Pointer to table entry	*/
+	struct	ptnode	*msgnode;	/* First node on message list	*/
+
+	mask = disable();
+	if ( isbadport(portid) ||
+	     (ptptr= &porttab[portid])->ptstate != PT_ALLOC ) {
+		restore(mask);
+		return (uint32)SYSERR;
+	}
+
+	/* Wait for message and verify that the port is still allocated */
+
+	seq = ptptr->ptseq;		/* Record orignal sequence	*/
+	if (wait(ptptr->ptrsem) == SYSERR || ptptr->ptstate != PT_ALLOC
+	    || ptptr->ptseq != seq) {
+		restore(mask);
+		return (uint32)SYSERR;
+	}
+
+	/* Dequeue first message that is waiting in the port */
+
+	msgnode = ptptr->pthead;
+	msg = msgnode->ptmsg;
+	if (ptptr->pthead == ptptr->pttail) {	/* Delete last item	*/
+		ptptr->pthead = ptptr->pttail = NULL;
+	} else {
+		ptptr->pthead = msgnode->ptnext;
+	}
+	msgnode->ptnext = ptfree;	/* Return to free list		*/
+	ptfree = msgnode;
+	signal(ptptr->ptssem);
+	restore(mask);
+	return msg;
+}
+
+/*------------------------------------------------------------------------
+ *  ptcount  -  Return the count of messages currently waiting in a port
+ *		  (a non-negative count K means the port contains K
+ *		   messages, a negative count -K means K processes are
+ *		   waiting to receive)
+ *------------------------------------------------------------------------
+ */
+int32	ptcount(
+	  int32		portid		/* ID of port to use		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	count;			/* Count of messages available	*/
+	struct	ptentry	*ptptr;		/* Pointer to port table entry	*/
+
+	mask = disable();
+	if ( isbadport(portid) ||
+	     (ptptr= &porttab[portid])->ptstate != PT_ALLOC ) {
+		restore(mask);
+		return SYSERR;
+	}
+	count = semtab[ptptr->ptrsem].scount;
+	restore(mask);
+	return count;
+}
+
+/*------------------------------------------------------------------------
+ *  ptdelete  -  Delete a port, freeing waiting processes and messages
+ *------------------------------------------------------------------------
+ */
+syscall	ptdelete(
+	  int32		portid,		/* ID of port to delete		*/
+	  int32		(*disp)(int32)	/* Function to call to dispose	*/
+	)				/*   of waiting messages	*/
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	ptentry	*ptptr;		/* Pointer to port table entry	*/
+
+	mask = disable();
+	if ( isbadport(portid) ||
+	     (ptptr= &porttab[portid])->ptstate != PT_ALLOC ) {
+		restore(mask);
+		return SYSERR;
+	}
+	ptspare += ptptr->ptmaxcnt;
+	_ptclear(ptptr, PT_FREE, disp);
+	ptnextid = portid;
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  ptreset  -  Reset a port, freeing waiting processes and messages and
+ *		  leaving the port ready for further use
+ *------------------------------------------------------------------------
+ */
+syscall	ptreset(
+	  int32		portid,		/* ID of port to reset		*/
+	  int32		(*disp)(int32)	/* Function to call to dispose	*/
+	)				/*   of waiting messages	*/
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	ptentry	*ptptr;		/* Pointer to port table entry	*/
+
+	mask = disable();
+	if ( isbadport(portid) ||
+	     (ptptr= &porttab[portid])->ptstate != PT_ALLOC ) {
+		restore(mask);
+		return SYSERR;
+	}
+	_ptclear(ptptr, PT_ALLOC, disp);
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  _ptclear  -  Used by ptdelete and ptreset to clear or reset a port
+ *		   (internal function assumes interrupts disabled and
+ *		   arguments have been checked for validity)
+ *------------------------------------------------------------------------
+ */
+local	void	_ptclear(
+	  struct ptentry *ptptr,	/* Table entry to clear		*/
+	  uint16	newstate,	/* New state for port		*/
+	  int32		(*dispose)(int32)/* Disposal function to call	*/
+	)
+{
+	struct	ptnode	*walk;		/* Pointer to walk message list	*/
+
+	/* Place port in limbo state while waiting processes are freed */
+
+	ptptr->ptstate = PT_LIMBO;
+
+	ptptr->ptseq++;			/* Reset accession number	*/
+	walk = ptptr->pthead;		/* First item on msg list	*/
+
+	if ( walk != NULL ) {		/* If message list nonempty	*/
+
+		/* Walk message list and dispose of each message */
+
+		for( ; walk!=NULL ; walk=walk->ptnext) {
+			if (dispose != NULL) {
+				(*dispose)( walk->ptmsg );
+			}
+		}
+
+		/* Link entire message list into the free list */
+
+		(ptptr->pttail)->ptnext = ptfree;
+		ptfree = ptptr->pthead;
+	}
+
+	if (newstate == PT_ALLOC) {
+		ptptr->pttail = ptptr->pthead = NULL;
+		semreset(ptptr->ptssem, ptptr->ptmaxcnt);
+		semreset(ptptr->ptrsem, 0);
+	} else {
+		semdelete(ptptr->ptssem);
+		semdelete(ptptr->ptrsem);
+	}
+	ptptr->ptstate = newstate;
+	return;
+}
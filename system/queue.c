@@ -1,8 +1,13 @@
-/* queue.c - enqueue, dequeue */
+/* queue.c - enqueue, dequeue, getfirst, getlast, getitem, insert,	*/
+/*	     insertd, newqueue, newreadyq				*/
 
 #include <xinu.h>
 
 struct qentry	queuetab[NQENT];	/* Table of process queues	*/
+uint32	rdysum;				/* Nonempty words of rdymap	*/
+uint32	rdymap[NRWORDS];		/* Nonempty ready list levels	*/
+
+local	void	rdyclear(int32);
 
 /*------------------------------------------------------------------------
  *  enqueue  -  Insert a process at the tail of a queue
@@ -61,14 +66,13 @@ pid32	getfirst(
 	)				/* Remove a process (assumed	*/
 					/*   valid with no check)	*/
 {
-	pid32	head;
+	pid32	first;
 
-	if (isempty(q)) {
+	first = firstid(q);
+	if (first >= NPROC) {
 		return EMPTY;
 	}
-
-	head = queuehead(q);
-	return getitem(queuetab[head].qnext);
+	return getitem(first);
 }
 
 /*------------------------------------------------------------------------
@@ -104,9 +108,31 @@ pid32	getitem(
 	prev = queuetab[pid].qprev;	/* Previous node in list	*/
 	queuetab[prev].qnext = next;
 	queuetab[next].qprev = prev;
+
+	/* Clear the bitmap when a ready list level becomes empty	*/
+
+	if (next == prev + 1 && isrdyhead(prev)) {
+		rdyclear((prev - readylist) >> 1);
+	}
 	return pid;
 }
 
+/*------------------------------------------------------------------------
+ *  rdyclear  -  Mark a ready list priority level as empty
+ *------------------------------------------------------------------------
+ */
+local	void	rdyclear(
+	  int32		level		/* Priority level now empty	*/
+	)
+{
+	uint32	w = level >> 5;		/* Word of rdymap for the level	*/
+
+	rdymap[w] &= ~(1U << (level & 31));
+	if (rdymap[w] == 0) {
+		rdysum &= ~(1U << w);
+	}
+}
+
 
 /*------------------------------------------------------------------------
  *  insert  -  Insert a process into a queue in descending key order
@@ -120,14 +146,25 @@ status	insert(
 {
 	qid16	curr;			/* Runs through items in a queue*/
 	qid16	prev;			/* Holds previous node index	*/
+	int32	level;			/* Ready list priority level	*/
 
 	if (isbadqid(q) || isbadpid(pid)) {
 		return SYSERR;
 	}
 
-	curr = firstid(q);
-	while (queuetab[curr].qkey >= key) {
-		curr = queuetab[curr].qnext;
+	/* The ready list keeps one FIFO per priority level, so a	*/
+	/*   process goes at the tail of its level in constant time	*/
+
+	if (q == readylist) {
+		level = rdylevel(key);
+		curr = queuetail(rdyqueue(level));
+		rdymap[level >> 5] |= 1U << (level & 31);
+		rdysum |= 1U << (level >> 5);
+	} else {
+		curr = firstid(q);
+		while (queuetab[curr].qkey >= key) {
+			curr = queuetab[curr].qnext;
+		}
 	}
 
 	/* Insert process between curr node and previous node */
@@ -159,6 +196,14 @@ status	insertd(			/* Assumes interrupts disabled	*/
 		return SYSERR;
 	}
 
+	/* Sleeping processes live in the timing wheel; the sleep	*/
+	/*   queue ID is only kept so existing callers still work	*/
+
+	if (q == sleepq) {
+		tminsert(&slptab[pid], key);
+		return OK;
+	}
+
 	prev = queuehead(q);
 	next = queuetab[queuehead(q)].qnext;
 	while ((next != queuetail(q)) && (queuetab[next].qkey <= key)) {
@@ -209,3 +254,26 @@ qid16	newqueue(void)
 	return q;
 }
 
+
+/*------------------------------------------------------------------------
+ *  newreadyq  -  Allocate the per-priority queues that form the ready
+ *		    list and return the ID used to refer to the whole list
+ *------------------------------------------------------------------------
+ */
+qid16	newreadyq(void)
+{
+	qid16		q;		/* ID of the level 0 queue	*/
+	int32		i;		/* Counts priority levels	*/
+
+	q = newqueue();
+	for (i = 1; i < NRPRIO; i++) {
+		if (newqueue() == SYSERR) {
+			return SYSERR;
+		}
+	}
+	rdysum = 0;
+	for (i = 0; i < NRWORDS; i++) {
+		rdymap[i] = 0;
+	}
+	return q;
+}
@@ -19,12 +19,9 @@ void *SVC_XINU_NULLPROCESS(uint32 *sp){
     struct procent * p;
     p = (struct procent *) sp[1]; 
             asm volatile ("mov r0, %0" : : "r" (p->prstkptr));
-                    asm volatile("ldmia r0!, {r4-r11} ");
+                    asm volatile("ldmia r0!, {r4-r11, lr} ");
                     asm volatile ("msr psp, r0");
-                    asm volatile (
-                          "ldr r0, =0xFFFFFFFD" "\n\t"
-                          "mov lr, r0" "\n\t"
-                          "bx lr");
+                    asm volatile ("bx lr");
     return sp; 
 }
 void *SVC_XINU_PUTC (uint32 *sp){
@@ -131,6 +128,10 @@ void *SVC_XINU_FREE_HEAP(uint32 *sp){
      sp[0]=heap_free();
      return sp;  
 } 
+void *SVC_XINU_HEAP_STAT(uint32 *sp){
+     sp[0]=heapstat((struct memstat *)sp[1]);
+     return sp;  
+}
 void *SVC_XINU_GETPID (uint32 *sp){
 
     
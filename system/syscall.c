@@ -171,6 +171,10 @@ uint32 sys_free_heap(){
     return __syscall(XINU_FREE_HEAP);
 }
 
+int sys_heap_stat(void *ms){
+    return __syscall(XINU_HEAP_STAT,ms);
+}
+
 
 uint32 len_fifo_usb(){
         return __syscall(XINU_GET_LEN);
@@ -235,6 +239,7 @@ int syscall_init(syscall_t *sys_obj){
     
     sys->len=len_fifo_usb;
     sys->fifo=fifo_usb;
+    sys->heapStat = sys_heap_stat;
     return 0;
 }
 
@@ -310,14 +315,14 @@ SVC_XINU_UPDATE_PATH,
 SVC_XINU_GET_PATH,
 SVC_XINU_CD,
 SVC_XINU_JSON,
-SVC_XINU_GET_LEN
+SVC_XINU_GET_LEN,
+SVC_XINU_HEAP_STAT
     // Agrega los punteros a funciones para los demás servicios aquí
 };
 
 
 void svccall_handler(uint32 *sp) {
-//uint32 q = disable();
-SYS_ENTRY();
+uint32 q = disable();
 uint32 svc_nr = sp[0];
 if (svc_nr >= 0 && svc_nr < sizeof(syscall_handlers) / sizeof(syscall_handler_t)) {
     syscall_handler_t handler = syscall_handlers[svc_nr];
@@ -325,6 +330,5 @@ if (svc_nr >= 0 && svc_nr < sizeof(syscall_handlers) / sizeof(syscall_handler_t)
 } else {
     kprintf("Syscall not implemented: %d\n", svc_nr);
 }
-SYS_EXIT();
-//restore(q);
+restore(q);
 }
\ No newline at end of file
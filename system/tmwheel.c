@@ -0,0 +1,336 @@
+/* tmwheel.c - tminit, tminsert, tmremove, tmadvance, tmnext, tmset,
+ *		tmrepeat, tmcancel */
+
+#include <xinu.h>
+
+uint32	tmnow;				/* Ticks the wheel has advanced	*/
+struct	tmnode	slptab[NPROC];		/* Wheel node of each process	*/
+
+local	struct	tmnode	*tmwheel[TMLEVELS][TMSLOTS]; /* Slot lists	*/
+local	uint32	tmmap[TMLEVELS];	/* Nonempty slots of each level	*/
+local	struct	tmnode	cotab[NCALLOUT];/* Callout nodes (free if no	*/
+					/*   tfunc)			*/
+local	uint32	conextid;		/* Next callout ID to hand out	*/
+
+local	void	tmlink(struct tmnode *);
+local	void	tmcascade(int32);
+local	int32	tmcallout(uint32, uint32, void (*)(int32), int32);
+
+/*------------------------------------------------------------------------
+ *  tminit  -  Initialize the timing wheel at startup
+ *------------------------------------------------------------------------
+ */
+void	tminit(void)
+{
+	int32	i, j;			/* Index levels, slots, procs	*/
+
+	tmnow = 0;
+	for (i = 0; i < TMLEVELS; i++) {
+		tmmap[i] = 0;
+		for (j = 0; j < TMSLOTS; j++) {
+			tmwheel[i][j] = NULL;
+		}
+	}
+	for (i = 0; i < NPROC; i++) {
+		slptab[i].tpprev = NULL;
+		slptab[i].tpid = i;
+		slptab[i].tfunc = NULL;
+	}
+	for (i = 0; i < NCALLOUT; i++) {
+		cotab[i].tpprev = NULL;
+		cotab[i].tfunc = NULL;
+	}
+	conextid = 0;
+}
+
+/*------------------------------------------------------------------------
+ *  tminsert  -  Schedule a node to expire after a delay in ticks
+ *------------------------------------------------------------------------
+ */
+void	tminsert(			/* Assumes interrupts disabled	*/
+	  struct tmnode	*tptr,		/* Node to schedule		*/
+	  uint32	delay		/* Ticks from now (0 means 1)	*/
+	)
+{
+	if (tmpending(tptr)) {
+		tmremove(tptr);
+	}
+	tptr->tdeadline = tmnow + (delay > 0 ? delay : 1);
+	tmlink(tptr);
+}
+
+/*------------------------------------------------------------------------
+ *  tmremove  -  Cancel a scheduled node
+ *------------------------------------------------------------------------
+ */
+void	tmremove(			/* Assumes interrupts disabled	*/
+	  struct tmnode	*tptr		/* Node to cancel		*/
+	)
+{
+	struct	tmnode	**head;		/* Slot the node is in		*/
+	int32	level;			/* Level of that slot		*/
+
+	if (!tmpending(tptr)) {
+		return;
+	}
+	if ((*tptr->tpprev = tptr->tnext) != NULL) {
+		tptr->tnext->tpprev = tptr->tpprev;
+	}
+
+	/* If the slot is now empty, clear its bit in the level map	*/
+
+	head = tptr->tpprev;
+	if (*head == NULL && head >= &tmwheel[0][0]
+	    && head < &tmwheel[0][0] + TMLEVELS * TMSLOTS) {
+		level = (head - &tmwheel[0][0]) >> TMBITS;
+		tmmap[level] &= ~(1U << ((head - &tmwheel[0][0]) & TMMASK));
+	}
+	tptr->tpprev = NULL;
+}
+
+/*------------------------------------------------------------------------
+ *  tmlink  -  Put a node in the slot that matches its deadline
+ *------------------------------------------------------------------------
+ */
+local	void	tmlink(
+	  struct tmnode	*tptr		/* Node to place		*/
+	)
+{
+	uint32	delta;			/* Ticks until the deadline	*/
+	int32	level;			/* Level whose range fits delta	*/
+	int32	slot;			/* Slot within that level	*/
+	struct	tmnode	**head;		/* Head of the slot list	*/
+
+	delta = tptr->tdeadline - tmnow;
+	for (level = 0; level < TMLEVELS - 1; level++) {
+		if (delta < (1U << (TMBITS * (level + 1)))) {
+			break;
+		}
+	}
+
+	/* Deadlines beyond the top level wrap around it and are	*/
+	/*   placed again each time their slot is cascaded		*/
+
+	slot = (tptr->tdeadline >> (TMBITS * level)) & TMMASK;
+	head = &tmwheel[level][slot];
+	if ((tptr->tnext = *head) != NULL) {
+		tptr->tnext->tpprev = &tptr->tnext;
+	}
+	*head = tptr;
+	tptr->tpprev = head;
+	tmmap[level] |= 1U << slot;
+}
+
+/*------------------------------------------------------------------------
+ *  tmcascade  -  Move the nodes of the current slot of a level down to
+ *		    the levels that now match their deadlines
+ *------------------------------------------------------------------------
+ */
+local	void	tmcascade(
+	  int32		level		/* Level to cascade from	*/
+	)
+{
+	int32	slot;			/* Current slot of the level	*/
+	struct	tmnode	*tptr;		/* Walks the slot list		*/
+	struct	tmnode	*next;		/* Node after tptr		*/
+
+	slot = (tmnow >> (TMBITS * level)) & TMMASK;
+	tptr = tmwheel[level][slot];
+	tmwheel[level][slot] = NULL;
+	tmmap[level] &= ~(1U << slot);
+	for (; tptr != NULL; tptr = next) {
+		next = tptr->tnext;
+		tmlink(tptr);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  tmadvance  -  Advance the wheel by a number of ticks, making ready
+ *		    every process whose deadline has been reached
+ *------------------------------------------------------------------------
+ */
+void	tmadvance(			/* Assumes interrupts disabled	*/
+	  uint32	ticks		/* Ticks that have elapsed	*/
+	)
+{
+	int32	level;			/* Level being cascaded		*/
+	int32	slot;			/* Current level 0 slot		*/
+	struct	tmnode	*tptr;		/* Node that has expired	*/
+
+	resched_cntl(DEFER_START);
+	while (ticks-- > 0) {
+		tmnow++;
+
+		/* When a level wraps, refill it from the level above	*/
+
+		for (level = 1; level < TMLEVELS; level++) {
+			if ((tmnow & ((1U << (TMBITS * level)) - 1)) != 0) {
+				break;
+			}
+		}
+		while (--level > 0) {
+			tmcascade(level);
+		}
+
+		/* Everything in the current level 0 slot is due now	*/
+
+		slot = tmnow & TMMASK;
+		while ((tptr = tmwheel[0][slot]) != NULL) {
+			tmremove(tptr);
+			if (tptr->tfunc == NULL) {
+				ready(tptr->tpid);
+				continue;
+			}
+
+			/* A callout: hand it to the work queue and either	*/
+			/*   schedule the next repeat or free the node	*/
+
+			wkpost(tptr->tfunc, tptr->targ);
+			if (tptr->tperiod != 0) {
+				tptr->tdeadline = tmnow + tptr->tperiod;
+				tmlink(tptr);
+			} else {
+				tptr->tfunc = NULL;
+			}
+		}
+	}
+	resched_cntl(DEFER_STOP);
+}
+
+/*------------------------------------------------------------------------
+ *  tmnext  -  Return the number of ticks the wheel can advance before it
+ *		 has work to do (a node expires or a slot must cascade)
+ *------------------------------------------------------------------------
+ */
+uint32	tmnext(void)
+{
+	int32	level;			/* Level being examined		*/
+	uint32	shift;			/* Bits of tmnow below a slot	*/
+	uint32	base;			/* Tick of next slot boundary	*/
+	uint32	map;			/* Slot map rotated to base	*/
+	uint32	when;			/* Earliest tick found so far	*/
+	uint32	t;			/* Tick of this level's event	*/
+
+	when = TMNONE;
+	for (level = 0; level < TMLEVELS; level++) {
+		if (tmmap[level] == 0) {
+			continue;
+		}
+
+		/* Find the first nonempty slot after the current one;	*/
+		/*   it is handled when tmnow reaches its boundary	*/
+
+		shift = TMBITS * level;
+		base = ((tmnow >> shift) + 1) << shift;
+		map = tmmap[level];
+		t = (base >> shift) & TMMASK;
+		map = (map >> t) | (t ? map << (TMSLOTS - t) : 0);
+		t = base + (__builtin_ctz(map) << shift) - tmnow;
+		if (t < when) {
+			when = t;
+		}
+	}
+	return when;
+}
+
+/*------------------------------------------------------------------------
+ *  tmset  -  Call a function once, from the work queue process, after
+ *	      a delay in milliseconds; return an ID for tmcancel
+ *------------------------------------------------------------------------
+ */
+int32	tmset(
+	  uint32	ms,		/* Milliseconds from now	*/
+	  void		(*func)(int32),	/* Function to call		*/
+	  int32		arg		/* Argument to pass it		*/
+	)
+{
+	return tmcallout(ms, 0, func, arg);
+}
+
+/*------------------------------------------------------------------------
+ *  tmrepeat  -  Call a function every ms milliseconds, starting ms
+ *		 milliseconds from now, until the callout is cancelled
+ *------------------------------------------------------------------------
+ */
+int32	tmrepeat(
+	  uint32	ms,		/* Period in milliseconds	*/
+	  void		(*func)(int32),	/* Function to call		*/
+	  int32		arg		/* Argument to pass it		*/
+	)
+{
+	if (ms == 0) {
+		return SYSERR;
+	}
+	return tmcallout(ms, ms, func, arg);
+}
+
+/*------------------------------------------------------------------------
+ *  tmcancel  -  Cancel a callout; a call already handed to the work
+ *		 queue still runs
+ *------------------------------------------------------------------------
+ */
+syscall	tmcancel(
+	  int32		id		/* ID from tmset or tmrepeat	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	tmnode	*tptr;		/* Node of the callout		*/
+
+	if (id < 0) {
+		return SYSERR;
+	}
+	mask = disable();
+	tptr = &cotab[id % NCALLOUT];
+	if (tptr->tfunc == NULL || tptr->tpid != id) {
+		restore(mask);		/* Already fired or cancelled	*/
+		return SYSERR;
+	}
+	tmremove(tptr);
+	tptr->tfunc = NULL;
+	restore(mask);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  tmcallout  -  Allocate a callout node and schedule it
+ *------------------------------------------------------------------------
+ */
+local	int32	tmcallout(
+	  uint32	ms,		/* Milliseconds to first call	*/
+	  uint32	period,		/* Milliseconds between calls	*/
+	  void		(*func)(int32),	/* Function to call		*/
+	  int32		arg		/* Argument to pass it		*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	i;			/* Counts callout nodes tried	*/
+	int32	id;			/* ID of the new callout	*/
+	struct	tmnode	*tptr;		/* Node being allocated		*/
+
+	if (func == NULL) {
+		return SYSERR;
+	}
+	mask = disable();
+
+	/* IDs advance on every allocation, so an ID held after its	*/
+	/*   callout fired does not match the node's next use.  The	*/
+	/*   counter is unsigned and wraps within 31 bits, so an ID is	*/
+	/*   never negative and cannot be mistaken for SYSERR		*/
+
+	for (i = 0; i < NCALLOUT; i++) {
+		id = (int32)conextid;
+		conextid = (conextid + 1) & 0x7FFFFFFF;
+		tptr = &cotab[id % NCALLOUT];
+		if (tptr->tfunc == NULL) {
+			tptr->tpid = id;
+			tptr->tfunc = func;
+			tptr->targ = arg;
+			tptr->tperiod = period;
+			tminsert(tptr, ms);
+			restore(mask);
+			return id;
+		}
+	}
+	restore(mask);
+	return SYSERR;
+}
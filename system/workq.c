@@ -0,0 +1,147 @@
+/* workq.c - wkinit, wkpost, wkwake, wkworker */
+
+#include <xinu.h>
+
+struct	wkentry	wktab[WKSLOTS];		/* The work ring		*/
+volatile uint32	wkhead;			/* Next position to post	*/
+uint32	wktail;				/* Next position to run		*/
+uint32	wkdropped;			/* Items lost to a full ring	*/
+
+local	pid32	wkpid;			/* ID of the worker process	*/
+local	volatile bool8 wkwaiting;	/* Worker is suspended, idle	*/
+
+/*------------------------------------------------------------------------
+ *  wkinit  -  Initialize the work ring (called before interrupts that
+ *		 post work are enabled)
+ *------------------------------------------------------------------------
+ */
+void	wkinit(void)
+{
+	int32	i;			/* Index into wktab		*/
+
+	for (i = 0; i < WKSLOTS; i++) {
+		wktab[i].wkseq = i;
+	}
+	wkhead = wktail = 0;
+	wkdropped = 0;
+	wkwaiting = FALSE;
+	wkpid = SYSERR;
+}
+
+/*------------------------------------------------------------------------
+ *  wkpost  -  Post a function to be run by the worker process (safe to
+ *		 call from any interrupt handler, including those above
+ *		 the kernel ceiling; never blocks or masks)
+ *------------------------------------------------------------------------
+ */
+status	wkpost(
+	  void		(*func)(int32),	/* Function to run		*/
+	  int32		arg		/* Argument to pass it		*/
+	)
+{
+	uint32	pos;			/* Ring position being claimed	*/
+	int32	diff;			/* Slot sequence minus pos	*/
+	struct	wkentry	*wkptr;		/* Slot at pos			*/
+
+	/* Claim a position; a nested handler that claims it first	*/
+	/*   makes the compare-and-swap fail and we try the next one	*/
+
+	pos = wkhead;
+	for (;;) {
+		wkptr = &wktab[pos & WKMASK];
+		diff = (int32)(wkptr->wkseq - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&wkhead, &pos,
+				pos + 1, FALSE, __ATOMIC_RELAXED,
+				__ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {	/* Slot not yet run: ring full	*/
+			wkdropped++;
+			return SYSERR;
+		} else {
+			pos = wkhead;
+		}
+	}
+
+	/* Fill the slot, then publish it to the worker */
+
+	wkptr->wkfunc = func;
+	wkptr->wkarg = arg;
+	__atomic_store_n(&wkptr->wkseq, pos + 1, __ATOMIC_RELEASE);
+
+	/* This handler may not touch the ready list, so leave waking	*/
+	/*   the worker to PendSV, which runs below the ceiling		*/
+
+	if (wkwaiting) {
+		PEND_SV();
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  wkwake  -  Called by PendSV_Handler before it picks a process: make
+ *		 the worker eligible again if work was posted while it was
+ *		 suspended
+ *------------------------------------------------------------------------
+ */
+void	wkwake(void)			/* Assumes interrupts disabled	*/
+{
+	struct	procent	*prptr;		/* Worker's process table entry	*/
+
+	if (!wkwaiting || wkempty()) {
+		return;
+	}
+	wkwaiting = FALSE;
+	prptr = &proctab[wkpid];
+	if (wkpid == currpid) {		/* Has not switched away yet	*/
+		prptr->prstate = PR_CURR;
+	} else {
+		prptr->prstate = PR_READY;
+		insert(wkpid, readylist, prptr->prprio);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  wkworker  -  Process that runs posted work items in batches
+ *------------------------------------------------------------------------
+ */
+process	wkworker(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	wkentry	*wkptr;		/* Slot at the tail		*/
+	void	(*func)(int32);		/* Function of the item		*/
+	int32	arg;			/* Argument of the item		*/
+
+	wkpid = getpid();
+	while (TRUE) {
+
+		/* Announce the suspension before the final check, so a	*/
+		/*   post that lands after the check sees wkwaiting	*/
+
+		mask = disable();
+		proctab[wkpid].prstate = PR_SUSP;
+		wkwaiting = TRUE;
+		if (wkempty()) {
+			resched();
+		} else {
+			wkwaiting = FALSE;
+			proctab[wkpid].prstate = PR_CURR;
+		}
+		restore(mask);
+
+		/* Run everything posted so far, including items posted	*/
+		/*   while the batch is running				*/
+
+		while (!wkempty()) {
+			wkptr = &wktab[wktail & WKMASK];
+			func = wkptr->wkfunc;
+			arg = wkptr->wkarg;
+			__atomic_store_n(&wkptr->wkseq, wktail + WKSLOTS,
+				__ATOMIC_RELEASE);
+			wktail++;
+			(*func)(arg);
+		}
+	}
+	return OK;
+}
@@ -0,0 +1,135 @@
+/* host.c - _start, hostexit, hostnow, printf, __udivmoddi4 */
+
+#include <xinu.h>
+#include <stdarg.h>
+
+/* Just enough of a C runtime to run kernel sources as a 32-bit Linux	*/
+/*   program without a C library: the tests are built with the same	*/
+/*   headers the kernel uses, so none of the host's can be included	*/
+
+extern	int	main(void);
+extern	void	_doprnt(char *, va_list, int (*)(int));
+
+local	char	outbuf[256];		/* Output not yet written	*/
+local	int32	outlen;			/* Bytes waiting in outbuf	*/
+
+/*------------------------------------------------------------------------
+ *  hostcall  -  Make a Linux i386 system call with up to three arguments
+ *------------------------------------------------------------------------
+ */
+local	int32	hostcall(
+	  int32		num,		/* System call number		*/
+	  int32		a,		/* First argument		*/
+	  int32		b,		/* Second argument		*/
+	  int32		c		/* Third argument		*/
+	)
+{
+	int32	ret;			/* Value the kernel returns	*/
+
+	asm volatile ("int $0x80" : "=a" (ret)
+			: "a" (num), "b" (a), "c" (b), "d" (c) : "memory");
+	return ret;
+}
+
+local	void	outflush(void)
+{
+	if (outlen > 0) {
+		hostcall(4, 1, (int32)outbuf, outlen);	/* write	*/
+		outlen = 0;
+	}
+}
+
+local	int	outchar(
+	  int		c		/* Character to write		*/
+	)
+{
+	outbuf[outlen++] = c;
+	if (c == '\n' || outlen == sizeof(outbuf)) {
+		outflush();
+	}
+	return c;
+}
+
+/*------------------------------------------------------------------------
+ *  printf  -  Format to the host's standard output
+ *------------------------------------------------------------------------
+ */
+int	printf(
+	  const char	*fmt,		/* Format string		*/
+	  ...
+	)
+{
+	va_list	ap;			/* Arguments to format		*/
+
+	va_start(ap, fmt);
+	_doprnt((char *)fmt, ap, outchar);
+	va_end(ap);
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ *  hostexit  -  End the program with a status for make to check
+ *------------------------------------------------------------------------
+ */
+void	hostexit(
+	  int32		status		/* 0 if every check passed	*/
+	)
+{
+	outflush();
+	for (;;) {
+		hostcall(1, status, 0, 0);		/* exit		*/
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  hostnow  -  Microseconds from the host's monotonic clock
+ *------------------------------------------------------------------------
+ */
+uint32	hostnow(void)
+{
+	struct	{
+		int32	sec;		/* Seconds			*/
+		int32	nsec;		/* Nanoseconds			*/
+	} ts;
+
+	hostcall(265, 1, (int32)&ts, 0);	/* clock_gettime	*/
+	return ts.sec * 1000000 + ts.nsec / 1000;
+}
+
+/*------------------------------------------------------------------------
+ *  __udivmoddi4  -  64-bit divide that gcc calls on i386; there is no
+ *		     32-bit libgcc to link, so do it a bit at a time
+ *------------------------------------------------------------------------
+ */
+uint64	__udivmoddi4(
+	  uint64	n,		/* Dividend			*/
+	  uint64	d,		/* Divisor			*/
+	  uint64	*rem		/* Remainder, if not NULL	*/
+	)
+{
+	uint64	q;			/* Quotient			*/
+	uint64	r;			/* Running remainder		*/
+	int32	i;			/* Bit of n being brought down	*/
+
+	q = 0;
+	r = 0;
+	for (i = 63; i >= 0; i--) {
+		r = (r << 1) | ((n >> i) & 1);
+		if (r >= d) {
+			r -= d;
+			q |= (uint64)1 << i;
+		}
+	}
+	if (rem != NULL) {
+		*rem = r;
+	}
+	return q;
+}
+
+void	_start(void)
+{
+	hostexit(main());
+	for (;;) {
+		;			/* hostexit does not return	*/
+	}
+}
@@ -0,0 +1,206 @@
+/* stdbuf_test.c - main */
+
+#include <xinu.h>
+#include <syscall.h>
+
+/* Runs lib/stdbuf.c against stand-ins for the devices, the heap and	*/
+/*   the XINU_PUTS system call.  Every write is logged as P<text>| for	*/
+/*   one puts or C<char> for one putc, so a check compares the log	*/
+/*   with the writes the buffering should have made.			*/
+
+#define	TTY	0			/* Device whose putc is ttyputc	*/
+#define	FILE	1			/* Device that is not a tty	*/
+#define	OTHER	2			/* Device other than stdout	*/
+
+struct	procent	proctab[NPROC];
+struct	dentry	devtab[NDEVS];
+pid32	currpid;
+syscall_t syscallp;
+
+local	char	wlog[2048];		/* Writes made so far		*/
+local	int32	wlen;			/* Bytes in wlog		*/
+local	int32	inuse;			/* Bytes getmem has handed out	*/
+local	int32	failed;			/* Checks that did not pass	*/
+
+devcall	ttyputc(struct dentry *devptr, char c)
+{
+	return OK;
+}
+
+syscall	putc(did32 dev, char c)
+{
+	wlog[wlen++] = 'C';
+	wlog[wlen++] = c;
+	return OK;
+}
+
+local	void	logputs(int dev, char *buf, int len)
+{
+	wlog[wlen++] = 'P';
+	while (len-- > 0) {
+		wlog[wlen++] = *buf++;
+	}
+	wlog[wlen++] = '|';
+}
+
+char	*getmem(uint32 nbytes)
+{
+	static	char	heap[1024];	/* Buffers are never reused	*/
+	static	int32	next;		/* Next free byte of heap	*/
+	char	*p;
+
+	if (next + nbytes > sizeof(heap)) {
+		return (char *)SYSERR;
+	}
+	p = &heap[next];
+	next += nbytes;
+	inuse += nbytes;
+	return p;
+}
+
+syscall	freemem(char *p, uint32 nbytes)
+{
+	inuse -= nbytes;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  check  -  Compare the writes logged since the last check with what
+ *		was expected, then clear the log
+ *------------------------------------------------------------------------
+ */
+local	void	check(
+	  char		*what,		/* Name of the check		*/
+	  char		*want		/* Expected log			*/
+	)
+{
+	wlog[wlen] = '\0';
+	if (strcmp(wlog, want) != 0) {
+		printf("FAIL %s: wrote \"%s\", expected \"%s\"\n", what,
+			wlog, want);
+		failed++;
+	}
+	wlen = 0;
+}
+
+local	void	emit(
+	  int		dev,		/* Device to write to		*/
+	  char		*s		/* Characters to write		*/
+	)
+{
+	while (*s != '\0') {
+		bufputc(dev, *s++);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  start  -  Make pid the current process, writing to dev as stdout
+ *------------------------------------------------------------------------
+ */
+local	void	start(
+	  pid32		pid,		/* Process to switch to		*/
+	  int		dev		/* Its stdout descriptor	*/
+	)
+{
+	currpid = pid;
+	proctab[pid].prdesc[1] = dev;
+}
+
+int	main(void)
+{
+	char	mine[8];		/* Buffer given to setvbuf	*/
+	char	full[BUFSIZ + 1];	/* Exactly one buffer of data	*/
+	int32	i;
+
+	syscallp.puts = logputs;
+	devtab[TTY].dvputc = ttyputc;
+
+	/* A tty is line buffered: one puts per line			*/
+
+	start(1, TTY);
+	emit(TTY, "abc");
+	check("line buffered, no newline", "");
+	emit(TTY, "\nde\n");
+	check("line buffered, two lines", "Pabc\n|Pde\n|");
+
+	/* Writing elsewhere flushes stdout first, keeping order	*/
+
+	emit(TTY, "xy");
+	bufputc(OTHER, 'z');
+	check("other device", "Pxy|Cz");
+
+	/* A file is fully buffered: newlines do not flush		*/
+
+	start(2, FILE);
+	emit(FILE, "a\nb\n");
+	check("full buffered, newlines", "");
+	fflush(FILE);
+	check("fflush", "Pa\nb\n|");
+	for (i = 0; i < BUFSIZ; i++) {
+		full[i] = 'f';
+	}
+	full[BUFSIZ] = '\0';
+	emit(FILE, full);
+	wlog[wlen] = '\0';
+	if (wlen != BUFSIZ + 2 || wlog[0] != 'P') {
+		printf("FAIL full buffer: %d bytes logged\n", wlen);
+		failed++;
+	}
+	wlen = 0;
+	fflush(FILE);
+	check("fflush of empty buffer", "");
+
+	/* setvbuf: unbuffered, then a caller's buffer of 8 bytes	*/
+
+	setvbuf(FILE, NULL, _IONBF, 0);
+	check("setvbuf frees the default buffer", "");
+	if (inuse != BUFSIZ) {		/* Process 1 still holds one	*/
+		printf("FAIL setvbuf left %d bytes allocated\n", inuse);
+		failed++;
+	}
+	emit(FILE, "no");
+	check("unbuffered", "CnCo");
+	setvbuf(FILE, mine, _IOFBF, sizeof(mine));
+	emit(FILE, "12345678");
+	check("caller's buffer, filled", "P12345678|");
+	emit(FILE, "9");
+	setvbuf(FILE, NULL, _IOLBF, 16);
+	check("setvbuf flushes first", "P9|");
+	emit(FILE, "line\n");
+	check("line buffered file", "Pline\n|");
+	if (setvbuf(TTY, NULL, _IOFBF, 16) != SYSERR
+	    || setvbuf(FILE, NULL, 99, 16) != SYSERR
+	    || setvbuf(FILE, NULL, _IOFBF, 0) != SYSERR) {
+		printf("FAIL setvbuf accepted bad arguments\n");
+		failed++;
+	}
+
+	/* Exit: kill flushes the caller's stdout and then calls	*/
+	/*   bufdone, which frees the buffer it allocated		*/
+
+	start(1, TTY);
+	emit(TTY, "bye");
+	check("before exit", "");
+	fflush(stdout);
+	bufdone(1);
+	check("flush on exit", "Pbye|");
+	start(2, FILE);
+	bufdone(2);
+	if (inuse != 0) {
+		printf("FAIL %d bytes not freed by bufdone\n", inuse);
+		failed++;
+	}
+
+	/* A new process in the slot starts over with a default buffer	*/
+
+	start(1, FILE);
+	emit(FILE, "new\n");
+	check("reused slot", "");
+	fflush(FILE);
+	check("reused slot flush", "Pnew\n|");
+
+	if (failed == 0) {
+		printf("stdbuf: all checks passed\n");
+	}
+	return failed;
+}
@@ -0,0 +1,201 @@
+/* string_test.c - main */
+
+#include <xinu.h>
+
+/* Checks the word-at-a-time routines in lib/string.c against the byte	*/
+/*   loops they replaced (shell/bytestr.c) on random sizes and		*/
+/*   alignments, then times both on the host the way "bench string"	*/
+/*   does on the board							*/
+
+#define	AREA	640			/* Bytes in each test buffer	*/
+#define	ROUNDS	200000			/* Random cases checked		*/
+#define	MAXN	4096			/* Largest size timed		*/
+#define	MOVED	(4 * 1024 * 1024)	/* Bytes per timing		*/
+
+extern	uint32	hostnow(void);
+
+local	unsigned char	a[AREA], b[AREA];	/* Buffer and its model	*/
+local	char	dbuf[MAXN + 8], sbuf[MAXN + 8];	/* Timing buffers	*/
+local	uint32	seed = 3;			/* Random number state	*/
+local	int32	failed;				/* Checks that failed	*/
+
+local	uint32	rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+local	void	fail(
+	  char		*what,		/* Routine that went wrong	*/
+	  int32		n,		/* Size of the case		*/
+	  int32		d,		/* Destination offset		*/
+	  int32		s		/* Source offset		*/
+	)
+{
+	if (failed++ < 10) {
+		printf("FAIL %s: n %d dst %d src %d\n", what, n, d, s);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  checkall  -  Run each routine and its byte loop on the same random
+ *		 case and compare the buffers and results
+ *------------------------------------------------------------------------
+ */
+local	void	checkall(void)
+{
+	int32	r, i, n, d, s, k;	/* Case number, size, offsets	*/
+	int32	c;			/* Byte to fill or find		*/
+
+	for (r = 0; r < ROUNDS; r++) {
+		n = rnd() % 300;
+		d = rnd() % 40;
+		s = rnd() % 40;
+		for (i = 0; i < AREA; i++) {
+			a[i] = b[i] = rnd();
+		}
+
+		switch (r % 6) {
+		case 0:
+			memcpy(a + 300 + d, a + s, n);
+			bytecpy(b + 300 + d, b + s, n);
+			break;
+		case 1:
+			c = rnd();
+			memset(a + d, c, n);
+			byteset(b + d, c, n);
+			break;
+		case 2:			/* Either direction, overlapping */
+			memmove(a + d, a + s, n);
+			bytemove(b + d, b + s, n);
+			break;
+		case 3:
+			bytecpy(a + 300 + d, a + s, n);
+			k = n ? rnd() % (n + 1) : 0;
+			if (k < n && (rnd() & 1)) {
+				a[300 + d + k] ^= 1 + rnd() % 255;
+			}
+			bytecpy(b, a, AREA);
+			if (memcmp(a + s, a + 300 + d, n)
+			    != bytecmp(a + s, a + 300 + d, n)) {
+				fail("memcmp", n, d, s);
+			}
+			break;
+		case 4:
+			for (i = 0; i < n; i++) {
+				if (a[s + i] == 0) {
+					a[s + i] = 1;
+				}
+			}
+			a[s + n] = 0;
+			bytecpy(b, a, AREA);
+			if (strlen((char *)a + s) != bytelen((char *)a + s)) {
+				fail("strlen", n, 0, s);
+			}
+			break;
+		case 5:
+			c = rnd() & 0xff;
+			if (memchr(a + s, c, n) != bytechr(a + s, c, n)) {
+				fail("memchr", n, 0, s);
+			}
+			break;
+		}
+		if (bytecmp(a, b, AREA) != 0) {
+			fail((r % 6 == 0) ? "memcpy" : (r % 6 == 1) ? "memset"
+				: "memmove", n, d, s);
+		}
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  mbps  -  Bytes moved in a number of microseconds as MB/s
+ *------------------------------------------------------------------------
+ */
+local	uint32	mbps(
+	  uint32	bytes,		/* Bytes processed		*/
+	  uint32	us		/* Microseconds it took		*/
+	)
+{
+	return (us == 0) ? 0 : bytes / us;
+}
+
+/*------------------------------------------------------------------------
+ *  timeall  -  Print MB/s of the byte loops and the word routines by
+ *		size and alignment, in the layout of "bench string"
+ *------------------------------------------------------------------------
+ */
+local	void	timeall(void)
+{
+	static	const	int32	dalign[] = {0, 1, 1};	/* Dst offsets	*/
+	static	const	int32	salign[] = {0, 1, 3};	/* Src offsets	*/
+	char	*d, *s;			/* Offset into the buffers	*/
+	int32	n, al, i, reps;		/* Size, case, repetitions	*/
+	uint32	start;			/* Clock sample			*/
+	uint32	t[6];			/* Microseconds per routine	*/
+
+	printf("%5s %5s %13s %13s %13s\n", "Size", "D/S", "memcpy MB/s",
+		"memset MB/s", "strlen MB/s");
+	printf("%5s %5s %6s %6s %6s %6s %6s %6s\n", "", "", "bytes", "words",
+		"bytes", "words", "bytes", "words");
+	printf("%5s %5s %6s %6s %6s %6s %6s %6s\n", "-----", "-----",
+		"------", "------", "------", "------", "------", "------");
+
+	for (n = 16; n <= MAXN; n *= 4) {
+		reps = MOVED / n;
+		for (al = 0; al < 3; al++) {
+			d = dbuf + dalign[al];
+			s = sbuf + salign[al];
+			byteset(s, 'x', n - 1);
+			s[n - 1] = '\0';
+
+			start = hostnow();
+			for (i = 0; i < reps; i++) {
+				bytecpy(d, s, n);
+			}
+			t[0] = hostnow() - start;
+			start = hostnow();
+			for (i = 0; i < reps; i++) {
+				memcpy(d, s, n);
+			}
+			t[1] = hostnow() - start;
+			start = hostnow();
+			for (i = 0; i < reps; i++) {
+				byteset(d, 0, n);
+			}
+			t[2] = hostnow() - start;
+			start = hostnow();
+			for (i = 0; i < reps; i++) {
+				memset(d, 0, n);
+			}
+			t[3] = hostnow() - start;
+			start = hostnow();
+			for (i = 0; i < reps; i++) {
+				bytelen(s);
+			}
+			t[4] = hostnow() - start;
+			start = hostnow();
+			for (i = 0; i < reps; i++) {
+				strlen(s);
+			}
+			t[5] = hostnow() - start;
+
+			printf("%5d %3d/%d", n, dalign[al], salign[al]);
+			for (i = 0; i < 6; i++) {
+				printf(" %6d", mbps(n * reps, t[i]));
+			}
+			printf("\n");
+		}
+	}
+}
+
+int	main(void)
+{
+	checkall();
+	if (failed != 0) {
+		printf("string: %d of %d cases failed\n", failed, ROUNDS);
+		return 1;
+	}
+	printf("string: %d random cases match the byte loops\n", ROUNDS);
+	timeall();
+	return 0;
+}
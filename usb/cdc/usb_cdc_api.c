@@ -262,6 +262,8 @@ uint8_t readBytes(char *buffer,uint8_t length){
 
 
 extern  void    ttyhandler(uint32, char c, int tipo);
+extern  void    ttyrxwork(int32);
+extern  status  wkpost(void (*)(int32), int32);
 
 /* CDC loop callback. Both for the Data IN and Data OUT endpoint */
 static void cdc_loopback(usbd_device *dev, uint8_t event, uint8_t ep) {
@@ -311,6 +313,11 @@ static void cdc_loopback(usbd_device *dev, uint8_t event, uint8_t ep) {
     
     
     restore(q); 
+
+    /* Line discipline runs later in the work queue process */
+    if (len > 0) {
+        wkpost(ttyrxwork, 0);
+    }
     #endif
     
 